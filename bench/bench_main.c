@@ -0,0 +1,356 @@
+/**
+ * Cortex-M0+ benchmark of the hot paths of the lib, run under QEMU by run.sh.
+ *
+ * Each run repeats one operation a number of times; run.sh counts the
+ * instructions of the whole run with the insn plugin of QEMU and takes
+ * out those of the "baseline" operation, which does nothing in the same
+ * loop. The "check" operation verifies the results once and sets the
+ * exit code.
+ *
+ * On the target, the arguments come from the semihosting command line
+ * (-semihosting-config enable=on,arg=bench,arg=<operation>,arg=<count>)
+ * and the output goes to the semihosting console. The same sources also
+ * build on a host, to check the operations:
+ *   gcc -I../eLichens_stm32/lib -I../eLichens_stm32/Inc -o bench bench_main.c \
+ *       bench_transport.c ../eLichens_stm32/lib/elCom.c ../eLichens_stm32/lib/crc_el.c \
+ *       ../eLichens_stm32/lib/ELICHENS_driver.c ../eLichens_stm32/lib/elCapture.c \
+ *       ../eLichens_stm32/lib/elMetrics.c ../eLichens_stm32/Src/xprintf.c
+ *   ./bench check
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "ELICHENS_driver.h"
+#include "crc_el.h"
+#include "xprintf.h"
+#include "bench_transport.h"
+
+
+#define BENCH_ITERATIONS			(1000)		// Default repetitions of an operation
+#define BENCH_CRC_CHECK				(0xFEE8)	// CRC16 BuyPass of "123456789"
+
+
+typedef struct {
+	const char	*name;
+	void		(*run)(void);
+} operation_t;
+
+static ELICHENS_Sensor_t sensor;
+static ELCOM_packet_t packet;
+static uint8_t frame[ELCOM_DATA_BUFFER_SIZE];
+static const uint8_t *response;
+static uint16_t responseSize;
+static uint8_t crcData[ELCOM_DATA_BUFFER_SIZE];
+static char line[128];
+static volatile uint32_t sink;			// Keeps the results of the operations alive
+
+
+/********************************************************************
+ * Platform
+ ********************************************************************/
+
+#ifdef __arm__
+
+#define SYS_WRITE0					(0x04)
+#define SYS_GET_CMDLINE				(0x15)
+#define SYS_EXIT					(0x18)
+#define ADP_STOPPED_APPLICATION_EXIT	(0x20026)
+
+extern uint32_t _estack, _sidata, _sdata, _edata, _sbss, _ebss;
+int main(void);
+
+
+static int semihost(int operation, void *argument)
+{
+	register int r0 __asm__("r0") = operation;
+	register void *r1 __asm__("r1") = argument;
+
+	__asm__ __volatile__ ("bkpt 0xAB" : "+r"(r0) : "r"(r1) : "memory");
+
+	return r0;
+}
+
+
+static void output(const char *text)
+{
+	semihost(SYS_WRITE0, (void *)text);
+}
+
+
+static void quit(int code)
+{
+	// Exit code 0 only: the 32-bit SYS_EXIT has no room for another one, QEMU then reports 1
+	semihost(SYS_EXIT, (void *)(code ? 0 : ADP_STOPPED_APPLICATION_EXIT));
+	for (;;) {
+	}
+}
+
+
+void Reset_Handler(void)
+{
+	uint32_t *source = &_sidata, *destination = &_sdata;
+
+	while (destination < &_edata) {
+		*destination++ = *source++;
+	}
+	for (destination = &_sbss; destination < &_ebss; destination++) {
+		*destination = 0;
+	}
+
+	quit(main());
+}
+
+
+void Default_Handler(void)
+{
+	output("fault\n");
+	quit(1);
+}
+
+
+__attribute__((section(".isr_vector"), used))
+static const void * const vectors[] = {
+	&_estack,
+	(void *)&Reset_Handler,
+	(void *)&Default_Handler,	// NMI
+	(void *)&Default_Handler,	// HardFault
+};
+
+#else
+
+#include <stdio.h>
+
+static void output(const char *text)
+{
+	fputs(text, stdout);
+}
+
+#endif
+
+
+/********************************************************************
+ * Operations
+ ********************************************************************/
+
+static void opBaseline(void)
+{
+}
+
+
+static void opEncode(void)
+{
+	packet.cmd = ELCOM_CMD_GET_SEN_DATA;
+	packet.dataLength = 1;
+	packet.data[0] = 0;
+	sink += ELCOM_prepareSendPacket(&packet, frame);
+}
+
+
+static void opParse(void)
+{
+	sink += ELCOM_parseReceivedPacket((uint8_t *)response, &packet);
+}
+
+
+static void opCrc8(void)
+{
+	sink += CRC_computeCRC(crcData, 8);
+}
+
+
+static void opCrc64(void)
+{
+	sink += CRC_computeCRC(crcData, 64);
+}
+
+
+static void opCrc248(void)
+{
+	sink += CRC_computeCRC(crcData, 248);
+}
+
+
+// The sample line of the STM32 example
+static void opFormat(void)
+{
+	xsprintf(line, "time = %d ; ppm = %d ; filtered = %d ; degC = %.2d%s",
+			BENCH_SENSOR_RUNTIME, BENCH_SENSOR_PPM, BENCH_SENSOR_PPM - 3, BENCH_SENSOR_TEMPERATURE, "");
+	sink += (uint8_t)line[0];
+}
+
+
+// The longest 32-bit decimal: ten digits through xdivu10() in xprintf.c
+static void opDecimal(void)
+{
+	xsprintf(line, "%u", 4294967295u);
+	sink += (uint8_t)line[0];
+}
+
+
+// One transaction through the driver and the emulated sensor
+static void opTransaction(void)
+{
+	ELICHENS_SensorData_t data;
+
+	sink += ELCOM_getSenData(&sensor, &data);
+}
+
+
+// Run time, concentration and temperature: what the examples read every period
+static void opSample(void)
+{
+	ELICHENS_Sample_t sample;
+
+	sink += ELCOM_getSample(&sensor, &sample);
+}
+
+
+static int check(void)
+{
+	ELICHENS_SensorData_t data;
+	ELICHENS_Sample_t sample;
+	int failures = 0;
+
+	if (BENCH_CRC_CHECK != CRC_computeCRC((uint8_t *)"123456789", 9)) {
+		output("check failed: crc\n");
+		failures++;
+	}
+
+	if (ELCOM_NO_ERROR != ELCOM_parseReceivedPacket((uint8_t *)response, &packet)
+			|| ELCOM_CMD_GET_SEN_DATA != packet.cmd) {
+		output("check failed: parse\n");
+		failures++;
+	}
+
+	opEncode();
+	if (ELCOM_NO_ERROR != ELCOM_parseReceivedPacket(frame, &packet) || 1 != packet.dataLength) {
+		output("check failed: encode\n");
+		failures++;
+	}
+
+	opFormat();
+	if (0 != strcmp(line, "time = 86400 ; ppm = 12345 ; filtered = 12342 ; degC = 23.45")) {
+		output("check failed: format\n");
+		failures++;
+	}
+
+	xsprintf(line, "%d %u %d %.3d %.2d", (int)(-2147483647 - 1), 4294967295u, 0, -5, 7);
+	if (0 != strcmp(line, "-2147483648 4294967295 0 -0.005 0.07")) {
+		output("check failed: decimal\n");
+		failures++;
+	}
+
+	if (ELCOM_NO_ERROR != ELCOM_getSenData(&sensor, &data) || BENCH_SENSOR_PPM != data.value) {
+		output("check failed: transaction\n");
+		failures++;
+	}
+
+	if (ELCOM_NO_ERROR != ELCOM_getSample(&sensor, &sample) || BENCH_SENSOR_RUNTIME != sample.runtime
+			|| BENCH_SENSOR_TEMPERATURE != sample.temperature) {
+		output("check failed: sample\n");
+		failures++;
+	}
+
+	output(failures ? "check failed\n" : "check passed\n");
+	return failures;
+}
+
+
+static const operation_t operations[] = {
+	{ "baseline", &opBaseline },
+	{ "encode", &opEncode },
+	{ "parse", &opParse },
+	{ "crc8", &opCrc8 },
+	{ "crc64", &opCrc64 },
+	{ "crc248", &opCrc248 },
+	{ "format", &opFormat },
+	{ "decimal", &opDecimal },
+	{ "transaction", &opTransaction },
+	{ "sample", &opSample },
+};
+
+
+/********************************************************************
+ * Main
+ ********************************************************************/
+
+static uint32_t parseCount(const char *text)
+{
+	uint32_t count = 0;
+
+	while (*text >= '0' && *text <= '9') {
+		count = 10 * count + (uint32_t)(*text++ - '0');
+	}
+
+	return count ? count : BENCH_ITERATIONS;
+}
+
+
+static int run(const char *name, uint32_t count)
+{
+	uint32_t i;
+	uint8_t op;
+
+	BENCH_transportInit(&sensor);
+	response = BENCH_transportResponse(ELCOM_CMD_GET_SEN_DATA, &responseSize);
+	for (i = 0; i < sizeof(crcData); i++) {
+		crcData[i] = (uint8_t)(i * 7 + 1);
+	}
+
+	if (0 == strcmp(name, "check")) {
+		return check();
+	}
+
+	for (op = 0; op < sizeof(operations) / sizeof(operations[0]); op++) {
+		if (0 == strcmp(name, operations[op].name)) {
+			for (i = 0; i < count; i++) {
+				operations[op].run();
+			}
+			return 0;
+		}
+	}
+
+	output("usage: bench check|baseline|encode|parse|crc8|crc64|crc248|format|decimal|transaction|sample [count]\n");
+	return 1;
+}
+
+
+#ifdef __arm__
+
+int main(void)
+{
+	static char cmdline[80];
+	struct {
+		char	*buffer;
+		int		size;
+	} argument = { cmdline, sizeof(cmdline) - 1 };
+	char *name, *count;
+
+	// "bench <operation> <count>"
+	if (0 != semihost(SYS_GET_CMDLINE, &argument)) {
+		output("no command line\n");
+		return 1;
+	}
+	cmdline[argument.size] = 0;
+
+	name = strchr(cmdline, ' ');
+	if (NULL == name) {
+		return run("", 0);
+	}
+	name++;
+	count = strchr(name, ' ');
+	if (NULL != count) {
+		*count++ = 0;
+	}
+
+	return run(name, parseCount(count ? count : ""));
+}
+
+#else
+
+int main(int argc, char **argv)
+{
+	return run((argc > 1) ? argv[1] : "", parseCount((argc > 2) ? argv[2] : ""));
+}
+
+#endif
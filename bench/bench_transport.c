@@ -0,0 +1,136 @@
+/**
+ * Emulated eLichens sensor for the benchmark (see bench_transport.h).
+ */
+#include <string.h>
+
+#include "bench_transport.h"
+
+
+typedef struct {
+	uint8_t		cmd;
+	uint8_t		size;
+	uint8_t		frame[ELCOM_DATA_BUFFER_SIZE];
+} response_t;
+
+static response_t responses[3];
+static ELICHENS_Sensor_t *sensor;
+static uint8_t *rxBuffer;
+static uint32_t tick;
+
+
+static void prepareResponse(response_t *response, uint8_t cmd, const uint8_t *data, uint8_t dataLength)
+{
+	ELCOM_packet_t packet;
+
+	packet.cmd = cmd;
+	packet.dataLength = dataLength;
+	memcpy(packet.data, data, dataLength);
+
+	response->cmd = cmd;
+	response->size = ELCOM_prepareSendPacket(&packet, response->frame);
+}
+
+
+/********************************************************************
+ * Transport callbacks
+ ********************************************************************/
+
+static ELCOM_errorCode_t benchTransmit(uint8_t *data, uint16_t size)
+{
+	uint16_t responseSize;
+	const uint8_t *response = BENCH_transportResponse(data[ELCOM_FIELD_CMD_POS], &responseSize);
+
+	// The sensor answers at once: the response is complete when the wait starts
+	if (NULL != response && NULL != rxBuffer) {
+		memcpy(rxBuffer, response, responseSize);
+		sensor->rxLength = responseSize;
+	}
+
+	return ELCOM_NO_ERROR;
+}
+
+
+static ELCOM_errorCode_t benchReceive(uint8_t *data)
+{
+	rxBuffer = data;
+
+	return ELCOM_NO_ERROR;
+}
+
+
+static ELCOM_errorCode_t benchWaitUntilReceived(void)
+{
+	if (ELCOM_RESPONSE_INCOMPLETE == ELCOM_getResponseState(rxBuffer, sensor->rxLength)) {
+		return ELCOM_SLAVE_TIMEOUT;
+	}
+
+	return ELCOM_NO_ERROR;
+}
+
+
+static void benchAbortReceive(void)
+{
+	rxBuffer = NULL;
+}
+
+
+static uint32_t benchGetTick(void)
+{
+	return tick++;
+}
+
+
+/********************************************************************
+ * Public functions
+ ********************************************************************/
+
+/**
+ * Prepare the responses and attach the emulated sensor to the driver.
+ */
+void BENCH_transportInit(ELICHENS_Sensor_t *sensorIn)
+{
+	uint8_t data[7];
+	int32_t value;
+
+	// Sensor index, status, error and the concentration in 1/100 ppm
+	data[0] = 0;
+	data[1] = 0;
+	data[2] = 0;
+	value = BENCH_SENSOR_PPM * 100;
+	memcpy(&data[3], &value, 4);
+	prepareResponse(&responses[0], ELCOM_CMD_GET_SEN_DATA, data, 7);
+
+	// Sensor index and the temperature
+	value = BENCH_SENSOR_TEMPERATURE;
+	memcpy(&data[1], &value, 4);
+	prepareResponse(&responses[1], ELCOM_CMD_GET_SEN_TEMP, data, 5);
+
+	value = BENCH_SENSOR_RUNTIME;
+	memcpy(&data[0], &value, 4);
+	prepareResponse(&responses[2], ELCOM_CMD_GET_RUN_TIME, data, 4);
+
+	sensor = sensorIn;
+	sensor->uartTransmit = &benchTransmit;
+	sensor->uartReceive = &benchReceive;
+	sensor->uartWaitUntilReceived = &benchWaitUntilReceived;
+	sensor->uartAbortReceive = &benchAbortReceive;
+	sensor->getTick = &benchGetTick;
+}
+
+
+/**
+ * Response of the emulated sensor to a command, NULL if it does not answer it.
+ */
+const uint8_t *BENCH_transportResponse(uint8_t cmd, uint16_t *size)
+{
+	uint8_t i;
+
+	for (i = 0; i < sizeof(responses) / sizeof(responses[0]); i++) {
+		if (responses[i].cmd == cmd) {
+			*size = responses[i].size;
+			return responses[i].frame;
+		}
+	}
+
+	return NULL;
+}
@@ -0,0 +1,21 @@
+/**
+ * Emulated eLichens sensor for the benchmark: answers every request at once
+ * with a response prepared beforehand, so that only the cost of the driver
+ * is measured.
+ */
+#ifndef __BENCH_TRANSPORT_H
+#define __BENCH_TRANSPORT_H
+
+#include "ELICHENS_driver.h"
+
+
+#define BENCH_SENSOR_PPM				(12345)		// Concentration sent by the emulated sensor
+#define BENCH_SENSOR_TEMPERATURE		(2345)		// Temperature, in 1/100 degC
+#define BENCH_SENSOR_RUNTIME			(86400)		// Run time, in s
+
+
+void BENCH_transportInit(ELICHENS_Sensor_t *sensor);
+const uint8_t *BENCH_transportResponse(uint8_t cmd, uint16_t *size);
+
+
+#endif /* __BENCH_TRANSPORT_H */
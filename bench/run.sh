@@ -0,0 +1,108 @@
+#!/bin/sh
+#
+# Instruction counts of the hot paths of the lib on a Cortex-M0+, under QEMU,
+# and the flash and RAM taken by each module.
+#
+# Needs arm-none-eabi-gcc (newlib-nano), qemu-system-arm and the insn plugin
+# of QEMU (libinsn.so, built with QEMU from tests/tcg/plugins or tests/plugin).
+#
+# Usage:
+#   PLUGIN=/path/to/libinsn.so ./run.sh [-n count] [-o results.txt] [-c reference.txt] [-t percent]
+#
+#   -n  repetitions of each operation (default 1000)
+#   -o  write the instructions per operation to a file, to keep as a reference
+#   -c  compare with a reference and fail if an operation costs more than
+#   -t  percent over its reference (default 2)
+#
+# Extra compiler flags go in CFLAGS_EXTRA, e.g. CFLAGS_EXTRA=-DCRC_IMPLEMENTATION=1
+# to measure the nibble CRC.
+
+set -e
+
+CROSS=${CROSS:-arm-none-eabi-}
+QEMU=${QEMU:-qemu-system-arm}
+COUNT=1000
+OUTPUT=
+REFERENCE=
+TOLERANCE=2
+
+while getopts n:o:c:t: opt; do
+	case $opt in
+	n) COUNT=$OPTARG ;;
+	o) OUTPUT=$OPTARG ;;
+	c) REFERENCE=$OPTARG ;;
+	t) TOLERANCE=$OPTARG ;;
+	*) exit 1 ;;
+	esac
+done
+
+if [ -z "$PLUGIN" ] || [ ! -f "$PLUGIN" ]; then
+	echo "set PLUGIN to the insn plugin of QEMU (libinsn.so)" >&2
+	exit 1
+fi
+
+cd "$(dirname "$0")"
+LIB=../eLichens_stm32/lib
+SRC=../eLichens_stm32/Src
+INC=../eLichens_stm32/Inc
+BUILD=build
+mkdir -p $BUILD
+
+# As the STM32 example: Cortex-M0+, optimized for size
+CFLAGS="-mcpu=cortex-m0plus -mthumb -Os -ffunction-sections -fdata-sections -Wall -I$LIB -I$INC -I. $CFLAGS_EXTRA"
+
+${CROSS}gcc $CFLAGS -nostartfiles --specs=nano.specs --specs=nosys.specs -Wl,--gc-sections -T qemu_microbit.ld \
+	-o $BUILD/bench.elf bench_main.c bench_transport.c \
+	$LIB/elCom.c $LIB/crc_el.c $LIB/ELICHENS_driver.c $LIB/elCapture.c $LIB/elMetrics.c $SRC/xprintf.c
+
+# Instructions executed by a whole run of an operation
+count() {
+	$QEMU -M microbit -display none -monitor none -serial none -kernel $BUILD/bench.elf \
+		-semihosting-config enable=on,target=native,arg=bench,arg=$1,arg=$2 \
+		-plugin "$PLUGIN" -d plugin 2>&1 | sed -n 's/.*insns: \([0-9][0-9]*\).*/\1/p'
+}
+
+if ! $QEMU -M microbit -display none -monitor none -serial none -kernel $BUILD/bench.elf \
+		-semihosting-config enable=on,target=native,arg=bench,arg=check; then
+	echo "the operations do not give the expected results" >&2
+	exit 1
+fi
+
+BASELINE=$(count baseline $COUNT)
+if [ -z "$BASELINE" ]; then
+	echo "no instruction count from $PLUGIN, run with -d plugin by hand to see why" >&2
+	exit 1
+fi
+RESULTS=$BUILD/results.txt
+: > $RESULTS
+
+echo "instructions per operation, $COUNT runs each:"
+for op in encode parse crc8 crc64 crc248 format decimal transaction sample; do
+	total=$(count $op $COUNT)
+	echo "$op $total $BASELINE $COUNT" | awk '{ printf "%s %.1f\n", $1, ($2 - $3) / $4 }' >> $RESULTS
+done
+awk '{ printf "  %-12s %10.1f\n", $1, $2 }' $RESULTS
+
+echo "flash and RAM per module (bytes, $CFLAGS_EXTRA):"
+printf "  %-16s %8s %8s\n" module flash ram
+for src in $LIB/*.c $SRC/xprintf.c; do
+	obj=$BUILD/$(basename "$src" .c).o
+	${CROSS}gcc $CFLAGS -c "$src" -o "$obj"
+	${CROSS}size "$obj" | awk -v m="$(basename "$src" .c)" 'NR == 2 { printf "  %-16s %8d %8d\n", m, $1 + $2, $2 + $3 }'
+done
+${CROSS}size $BUILD/bench.elf | awk 'NR == 2 { printf "  %-16s %8d %8d\n", "bench.elf", $1 + $2, $2 + $3 }'
+
+if [ -n "$OUTPUT" ]; then
+	cp $RESULTS "$OUTPUT"
+fi
+
+# Regression check against a reference run
+if [ -n "$REFERENCE" ]; then
+	awk -v tolerance="$TOLERANCE" '
+		NR == FNR { reference[$1] = $2; next }
+		($1 in reference) && $2 > reference[$1] * (1 + tolerance / 100) {
+			printf "regression: %s %.1f instructions, %.1f in the reference\n", $1, $2, reference[$1]
+			failed = 1
+		}
+		END { exit failed }' "$REFERENCE" $RESULTS
+fi
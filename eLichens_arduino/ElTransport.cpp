@@ -0,0 +1,173 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include "ElTransport.h"
+
+#include <string.h>
+
+
+ElTransport *ElTransport::instance = NULL;
+
+
+ElTransport::ElTransport(Stream &stream)
+  : stream(stream), sensor(NULL), idle(NULL), bufferRx(NULL), receivedCount(0)
+{
+  resetStats();
+}
+
+
+/**
+ * Route the sensor's UART callbacks to this transport.
+ */
+void ElTransport::attach(ELICHENS_Sensor_t *sensor)
+{
+  instance = this;
+  this->sensor = sensor;
+
+  sensor->uartTransmit = &ElTransport::transmit;
+  sensor->uartReceive = &ElTransport::receive;
+  sensor->uartWaitUntilReceived = &ElTransport::waitUntilReceived;
+  sensor->uartAbortReceive = &ElTransport::abortReceive;
+}
+
+
+/**
+ * Function called repeatedly while a response is awaited (NULL to disable).
+ */
+void ElTransport::setIdleCallback(void (*idle)(void))
+{
+  this->idle = idle;
+}
+
+
+uint16_t ElTransport::getReceivedCount(void) const
+{
+  return receivedCount;
+}
+
+
+const ElTransportStats &ElTransport::getStats(void) const
+{
+  return stats;
+}
+
+
+void ElTransport::resetStats(void)
+{
+  memset(&stats, 0, sizeof(stats));
+}
+
+
+/**
+ * Move the pending bytes from the serial to the receive buffer, bounded to its size.
+ */
+void ElTransport::poll(void)
+{
+  while (stream.available()) {
+    uint8_t c = stream.read();
+
+    if (NULL == bufferRx || receivedCount >= ELCOM_DATA_BUFFER_SIZE) {
+      stats.bytesDropped++;
+      continue;
+    }
+    bufferRx[receivedCount++] = c;
+    stats.bytesRx++;
+  }
+
+  sensor->rxLength = receivedCount;
+}
+
+
+void ElTransport::flush(void)
+{
+  while (stream.available()) {
+    stream.read();
+    stats.bytesDropped++;
+  }
+}
+
+
+ELCOM_errorCode_t ElTransport::transmit(uint8_t *data, uint16_t size)
+{
+  uint32_t start = micros();
+
+  // Blocks with interrupts disabled on a SoftwareSerial, only fills a buffer on a HardwareSerial
+  instance->stream.write(data, size);
+
+  instance->stats.bytesTx += size;
+  instance->stats.busyMicros += micros() - start;
+
+  return ELCOM_NO_ERROR;
+}
+
+
+ELCOM_errorCode_t ElTransport::receive(uint8_t *data)
+{
+  // Drop any stale data
+  instance->flush();
+
+  instance->bufferRx = data;
+  instance->receivedCount = 0;
+
+  return ELCOM_NO_ERROR;
+}
+
+
+ELCOM_errorCode_t ElTransport::waitUntilReceived(void)
+{
+  uint32_t start = millis();
+  uint32_t busy;
+
+  instance->stats.transactions++;
+
+  while (millis() - start < EL_TRANSPORT_TIMEOUT_MS) {
+    busy = micros();
+    instance->poll();
+
+    // Stop early on a frame that cannot be valid, ELCOM_parseReceivedPacket() reports why
+    if (ELCOM_RESPONSE_INCOMPLETE != ELCOM_getResponseState(instance->bufferRx, instance->receivedCount)) {
+      instance->stats.busyMicros += micros() - busy;
+      return ELCOM_NO_ERROR;
+    }
+    instance->stats.busyMicros += micros() - busy;
+
+    // Let the sketch do something useful meanwhile
+    if (NULL != instance->idle) {
+      instance->idle();
+    }
+  }
+
+  instance->stats.timeouts++;
+  return ELCOM_SLAVE_TIMEOUT;
+}
+
+
+void ElTransport::abortReceive(void)
+{
+  instance->bufferRx = NULL;
+  instance->flush();
+}
@@ -0,0 +1,91 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#ifndef __EL_TRANSPORT_H__
+#define __EL_TRANSPORT_H__
+
+#include <Arduino.h>
+
+#include "ELICHENS_driver.h"
+
+
+#define EL_TRANSPORT_TIMEOUT_MS       (250)   // Maximum time to wait for a response
+
+
+/********************************************************************
+ * Arduino transport for the sensor's UART
+ *
+ * Implements the ELICHENS_Sensor_t callbacks on top of any Stream.
+ * Received bytes are stored in the sensor's receive buffer and never
+ * past its end. While a response is awaited, an idle callback keeps
+ * being called so that the sketch can service its other tasks (it
+ * must not start another sensor transaction).
+ *
+ * Callbacks have no context, so a single transport can be attached.
+ ********************************************************************/
+
+typedef struct {
+  uint32_t transactions;        // Responses awaited
+  uint32_t timeouts;            // Responses not complete in time
+  uint32_t bytesTx;             // Bytes sent
+  uint32_t bytesRx;             // Bytes stored in the receive buffer
+  uint32_t bytesDropped;        // Unexpected bytes flushed, or received past the end of the buffer
+  uint32_t busyMicros;          // CPU time spent sending and receiving, idle callback excluded
+} ElTransportStats;
+
+class ElTransport {
+public:
+  ElTransport(Stream &stream);
+
+  void attach(ELICHENS_Sensor_t *sensor);
+  void setIdleCallback(void (*idle)(void));
+
+  uint16_t getReceivedCount(void) const;
+  const ElTransportStats &getStats(void) const;
+  void resetStats(void);
+
+private:
+  static ElTransport *instance;
+
+  static ELCOM_errorCode_t transmit(uint8_t *data, uint16_t size);
+  static ELCOM_errorCode_t receive(uint8_t *data);
+  static ELCOM_errorCode_t waitUntilReceived(void);
+  static void abortReceive(void);
+
+  void poll(void);
+  void flush(void);
+
+  Stream &stream;
+  ELICHENS_Sensor_t *sensor;
+  void (*idle)(void);
+  uint8_t *bufferRx;
+  uint16_t receivedCount;       // Bytes stored in bufferRx
+  ElTransportStats stats;
+};
+
+
+#endif // __EL_TRANSPORT_H__
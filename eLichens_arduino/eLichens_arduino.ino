@@ -1,149 +1,493 @@
-#include <SoftwareSerial.h>
-
 #include "ELICHENS_driver.h"
-
+#include "ElTransport.h"
+#include "elSchedule.h"
+#include "elFilter.h"
+#include "elGate.h"
+#include "elRate.h"
+#include "elAlarm.h"
+#include "elChange.h"
+#include "elReport.h"
+#include "elWindow.h"
+#include "elBatch.h"
+
+
+// Use a hardware UART when the board has a spare one (Mega, Leonardo, SAMD...),
+// otherwise fall back to a SoftwareSerial
+#if defined(HAVE_HWSERIAL1) || defined(ARDUINO_ARCH_SAMD)
+#define SENSOR_SERIAL_HW
+#endif
+
+#ifndef SENSOR_SERIAL_HW
+#include <SoftwareSerial.h>
 
 #define SENSOR_SERIAL_TX_PIN (6)
 #define SENSOR_SERIAL_RX_PIN (7)
-
-
+#endif
+
+#define INFO_PERIOD_MS       (200)    // Time between two static information requests
+#define SAMPLE_PERIOD_MS     (1000)   // Time between two samples while the concentration moves
+#define SAMPLE_PERIOD_MAX_MS (8000)   // Time between two samples while it is flat
+#define RATE_SLOPE_LIMIT     (20)     // Slope polling fast, in ppm/s
+#define RATE_VARIANCE_LIMIT  (100)    // Variance polling fast, in ppm^2
+#define ALARM_HIGH_PPM       (1000)
+#define ALARM_HIGH_HIGH_PPM  (5000)
+#define ALARM_HYSTERESIS_PPM (100)
+#define ALARM_RISE_PPM_S     (50)
+#define ALARM_CONFIRM_MS     (1000)   // Time between the samples confirming an alarm: the sensor refresh
+#define CHANGE_ALLOWANCE_PPM (10)     // Half the smallest sustained shift to detect
+#define CHANGE_CUSUM_PPM     (200)
+#define CHANGE_EWMA_PPM      (15)
+#define REPORT_DEADBAND_PPM  (20)     // Report a sample when it moved by more than 20 ppm,
+#define REPORT_DEADBAND_PERMILLE (50) // or 5 % at high concentrations,
+#define REPORT_HEARTBEAT_MS  (60000)  // or after a minute without report
+#define WINDOW_LENGTH_MS     (60000)  // One summary of the samples a minute
+#define BATCH_MAX_SAMPLES    (32)     // Samples per uplink frame at most,
+#define BATCH_MAX_AGE_MS     (300000) // and 5 minutes of delay at most
+#define HEARTBEAT_PERIOD_MS  (500)
+// 1: reported samples are written to Serial in binary batches, decoded on the host by
+// tools/elbatch_decode.c. The batch takes about 1.2 KB of RAM: not for a Uno
+#define UPLINK_BATCH         (0)
+#define STATS_PERIOD         (60)     // Samples between two statistics reports
+
+// Optional stages, 1 to enable. They are off by default on the AVR boards with 2.5 KB of SRAM or
+// less (Uno, Nano, Leonardo...), where the sensor buffers already take about 800 bytes: together
+// they need about 250 more bytes of globals and 140 of stack
+#if defined(RAMEND) && (RAMEND < 0xB00)
+#define SMALL_RAM            (1)
+#else
+#define SMALL_RAM            (0)
+#endif
+#define SENSOR_METRICS       (!SMALL_RAM) // Transactions, outcomes and latencies in the statistics
+#define CHANGE_DETECTOR      (!SMALL_RAM) // Early warning of small leaks
+#define SAMPLE_WINDOW        (!SMALL_RAM) // Summary of the samples of each window
+
+
+#ifdef SENSOR_SERIAL_HW
+#define sensorSerial Serial1
+#else
 SoftwareSerial sensorSerial (SENSOR_SERIAL_RX_PIN, SENSOR_SERIAL_TX_PIN);
+#endif
+ElTransport transport (sensorSerial);
 
-// Prototype for our UART communication
-ELCOM_errorCode_t el_uartTransmit(uint8_t *data, uint16_t size);
-ELCOM_errorCode_t el_uartReceive(uint8_t *data);
-ELCOM_errorCode_t el_uartWaitUntilReceived(void);
-void el_uartAbortReceive(void);
+uint32_t el_getTick(void);
+void serviceTasks(void);
+void alarmCallback(ELALARM_alarm_t *alarm, uint8_t flag, uint8_t raised, int32_t value);
+void uplinkSend(const uint8_t *frame, uint16_t size);
 
 // Define our sensor
 ELICHENS_Sensor_t sensor;
 
+#if SENSOR_METRICS
+// Transactions with the sensor, outcomes and latencies
+ELMETRICS_metrics_t sensorMetrics;
+#endif
+
+// Nothing in loop() blocks: each state runs when its deadline is reached,
+// samples are taken on a fixed-rate schedule so that their period does not drift
+enum {
+  STATE_STARTUP,
+  STATE_INFO,
+  STATE_SAMPLE,
+} state = STATE_STARTUP;
+
+uint32_t deadline;
+uint8_t infoStep = 0;
+ELSCHED_schedule_t sampleSchedule;
+
+// Smoothed concentration: median of 3 against spikes, then EMA with alpha = 1/4
+ELFILTER_stage_t ppmStages[2];
+ELFILTER_chain_t ppmFilter = { ppmStages, 2 };
+
+// Skip warm-up and calibration samples, and poll slower meanwhile
+ELGATE_gate_t statusGate;
+
+// Poll slowly while the concentration is flat
+ELRATE_rate_t sampleRate;
+
+// Leak alarms, confirmed by the next measurements of the sensor
+ELALARM_alarm_t ppmAlarm;
+
+#if CHANGE_DETECTOR
+// Early warning of small leaks, well below the alarm thresholds
+ELCHANGE_detector_t ppmChange;
+uint8_t ppmChangeFlags = 0;
+#endif
+
+// Report by exception to save the link
+ELREPORT_deadband_t ppmReport;
+
+#if SAMPLE_WINDOW
+// Summary of the samples of each window
+ELWINDOW_window_t sampleWindow;
+#endif
+
+#if UPLINK_BATCH
+// Reported samples, sent in compressed binary frames rather than text lines
+ELBATCH_batch_t uplinkBatch;
+#endif
+
 
 void setup() {
-  ELCOM_errorCode_t error_code;
-  char str[24];
-  uint32_t sn;
-  
   // Logging
   Serial.begin(115200);
 
   // Sensor
   sensorSerial.begin(57600);
 
-  sensor.uartTransmit = &el_uartTransmit;
-  sensor.uartReceive = &el_uartReceive;
-  sensor.uartWaitUntilReceived = &el_uartWaitUntilReceived;
-  sensor.uartAbortReceive = &el_uartAbortReceive;
+  transport.attach(&sensor);
+  transport.setIdleCallback(&serviceTasks);
+  sensor.getTick = &el_getTick;
+#if SENSOR_METRICS
+  sensor.metrics = &sensorMetrics;
+#endif
+
+  pinMode(LED_BUILTIN, OUTPUT);
+
+  ELFILTER_initMedian(&ppmStages[0], 3);
+  ELFILTER_initEma(&ppmStages[1], 2);
 
   // Init
+  deadline = millis() + EL_STARTUP_DELAY_MS;
+}
 
-  delay(EL_STARTUP_DELAY_MS);
+void loop() {
+  serviceTasks();
 
-  ELCOM_getSysModelName(&sensor, str);
-  Serial.print("Model name: ");
-  Serial.println(str);
-  delay(200);
+  if (STATE_SAMPLE == state) {
+    if (ELSCHED_isDue(&sampleSchedule, millis())) {
+      readSample();
+    }
+    return;
+  }
 
-  ELCOM_getSysProdName(&sensor, str);
-  Serial.print("Product name: ");
-  Serial.println(str);
-  delay(200);
+  if ((int32_t)(millis() - deadline) < 0) {
+    return; // Not yet
+  }
 
-  ELCOM_getSysFwVer(&sensor, str);
-  Serial.print("Firmware version: ");
-  Serial.println(str);
-  delay(200);
+  switch (state) {
+    case STATE_STARTUP:
+      state = STATE_INFO;
+      break;
+
+    case STATE_INFO:
+      if (readInfo(infoStep++)) {
+        deadline += INFO_PERIOD_MS;
+      }
+      else {
+        state = STATE_SAMPLE;
+        ELSCHED_init(&sampleSchedule, SAMPLE_PERIOD_MS, millis());
+        ELGATE_init(&statusGate, SAMPLE_PERIOD_MS, millis());
+        ELRATE_init(&sampleRate, SAMPLE_PERIOD_MS, SAMPLE_PERIOD_MAX_MS, RATE_SLOPE_LIMIT, RATE_VARIANCE_LIMIT);
+        ELALARM_init(&ppmAlarm, ALARM_HIGH_PPM, ALARM_HIGH_HIGH_PPM, ALARM_HYSTERESIS_PPM, ALARM_RISE_PPM_S, &alarmCallback);
+#if CHANGE_DETECTOR
+        ELCHANGE_init(&ppmChange, CHANGE_ALLOWANCE_PPM, CHANGE_CUSUM_PPM, CHANGE_EWMA_PPM);
+#endif
+        ELREPORT_init(&ppmReport, REPORT_DEADBAND_PPM, REPORT_DEADBAND_PERMILLE, REPORT_HEARTBEAT_MS);
+#if SAMPLE_WINDOW
+        ELWINDOW_init(&sampleWindow, WINDOW_LENGTH_MS, millis());
+#endif
+#if UPLINK_BATCH
+        ELBATCH_init(&uplinkBatch, BATCH_MAX_SAMPLES, BATCH_MAX_AGE_MS, 1, &uplinkSend);
+#endif
+      }
+      break;
+
+    default:
+      break;
+  }
+}
 
-  ELCOM_getSysSn(&sensor, &sn);
-  Serial.print("Serial number: ");
-  Serial.println(sn);
-  delay(200);
 
-  ELCOM_getSenName(&sensor, str);
-  Serial.print("Sensor's name: ");
-  Serial.println(str);
-  delay(200);
+/**
+ * Everything the sketch must keep doing, including while waiting for the
+ * sensor: poll buttons, serve the radio... It must not talk to the sensor.
+ */
+void serviceTasks(void)
+{
+  static uint32_t lastBlink = 0;
 
-  // Load sensor's format
-  ELCOM_getSenDataFmt(&sensor, &sensor.dataFormat);
-  delay(200);
+  if (millis() - lastBlink >= HEARTBEAT_PERIOD_MS) {
+    lastBlink = millis();
+    digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
+  }
 }
 
-void loop() {
-  ELCOM_errorCode_t error_code;
-  uint32_t runtime;
-  ELICHENS_SensorData_t data;
-  float temperature;
 
-  error_code = ELCOM_getSysRunTime(&sensor, &runtime);
-  error_code |= ELCOM_getSenData(&sensor, &data);
-  error_code |= ELCOM_getSenTemp(&sensor, &temperature);
+/**
+ * Read one of the static information, returns false once all have been read.
+ */
+bool readInfo(uint8_t step)
+{
+  char str[24];
+  uint32_t sn;
+
+  switch (step) {
+    case 0:
+      ELCOM_getSysModelName(&sensor, str);
+      Serial.print(F("Model name: "));
+      Serial.println(str);
+      return true;
+
+    case 1:
+      ELCOM_getSysProdName(&sensor, str);
+      Serial.print(F("Product name: "));
+      Serial.println(str);
+      return true;
+
+    case 2:
+      ELCOM_getSysFwVer(&sensor, str);
+      Serial.print(F("Firmware version: "));
+      Serial.println(str);
+      return true;
+
+    case 3:
+      ELCOM_getSysSn(&sensor, &sn);
+      Serial.print(F("Serial number: "));
+      Serial.println(sn);
+      return true;
+
+    case 4:
+      ELCOM_getSenName(&sensor, str);
+      Serial.print(F("Sensor's name: "));
+      Serial.println(str);
+      return true;
+
+    case 5:
+      // Load sensor's format
+      ELCOM_getSenDataFmt(&sensor, &sensor.dataFormat);
+      return true;
+
+    default:
+      return false;
+  }
+}
 
-  if (ELCOM_NO_ERROR == error_code) {
-     Serial.print("time = ");
-     Serial.print(runtime);
-     Serial.print(" ; ppm = ");
-     Serial.print(data.value);
-     Serial.print(" ; degC = ");
-     Serial.println(temperature);
+
+void printStats(void)
+{
+  const ElTransportStats &stats = transport.getStats();
+
+  Serial.print(F("Transport: transactions = "));
+  Serial.print(stats.transactions);
+  Serial.print(F(" ; timeouts = "));
+  Serial.print(stats.timeouts);
+  Serial.print(F(" ; bytes tx/rx/dropped = "));
+  Serial.print(stats.bytesTx);
+  Serial.print(F("/"));
+  Serial.print(stats.bytesRx);
+  Serial.print(F("/"));
+  Serial.print(stats.bytesDropped);
+  Serial.print(F(" ; CPU us/transaction = "));
+  Serial.println(stats.transactions ? stats.busyMicros / stats.transactions : 0);
+
+#if SENSOR_METRICS
+  ELMETRICS_counters_t metrics;
+
+  ELMETRICS_snapshot(&sensorMetrics, &metrics);
+  Serial.print(F("Sensor: data/temp = "));
+  Serial.print(metrics.transactions[ELMETRICS_getCommandSlot(ELCOM_CMD_GET_SEN_DATA)]);
+  Serial.print(F("/"));
+  Serial.print(metrics.transactions[ELMETRICS_getCommandSlot(ELCOM_CMD_GET_SEN_TEMP)]);
+  Serial.print(F(" ; retries = "));
+  Serial.print(metrics.retries);
+  Serial.print(F(" ; outcomes ="));
+  for (uint8_t i = 0; i < ELMETRICS_OUTCOME_COUNT; i++) {
+    Serial.print(F(" "));
+    Serial.print(metrics.outcomes[i]);
   }
-  else {
-    Serial.println("Failed to read sensor value");
+  Serial.print(F(" ; latency ms histogram ="));
+  for (uint8_t i = 0; i < ELMETRICS_LATENCY_BINS; i++) {
+    Serial.print(F(" "));
+    Serial.print(metrics.latency[i]);
   }
-
-  delay(1000);
+  Serial.print(F(" ; max = "));
+  Serial.println(metrics.latencyMax);
+#endif
+
+  Serial.print(F("Schedule: period us = "));
+  Serial.print(ELSCHED_getAchievedPeriod(&sampleSchedule, 1000));
+  Serial.print(F(" ; missed = "));
+  Serial.print(sampleSchedule.missed);
+  Serial.print(F(" ; late ms histogram ="));
+  for (uint8_t i = 0; i < ELSCHED_JITTER_BINS; i++) {
+    Serial.print(F(" "));
+    Serial.print(sampleSchedule.jitter[i]);
+  }
+  Serial.println();
+
+  Serial.print(F("Reports: emitted = "));
+  Serial.print(ppmReport.emitted);
+  Serial.print(F(" ; suppressed = "));
+  Serial.println(ppmReport.suppressed);
+
+#if UPLINK_BATCH
+  Serial.print(F("Uplink: frames = "));
+  Serial.print(uplinkBatch.frames);
+  Serial.print(F(" ; samples = "));
+  Serial.print(uplinkBatch.samples);
+  Serial.print(F(" ; bytes raw/sent = "));
+  Serial.print(uplinkBatch.bytesRaw);
+  Serial.print(F("/"));
+  Serial.println(uplinkBatch.bytesSent);
+#endif
+
+  transport.resetStats();
+#if SENSOR_METRICS
+  ELMETRICS_reset(&sensorMetrics);
+#endif
+  ELSCHED_resetStats(&sampleSchedule);
+  ELREPORT_resetStats(&ppmReport);
 }
 
 
-ELCOM_errorCode_t el_uartTransmit(uint8_t *data, uint16_t size)
+#if SAMPLE_WINDOW
+void printSummary(const ELWINDOW_summary_t *summary)
 {
-  sensorSerial.write(data, size);
-  return ELCOM_NO_ERROR;
+  Serial.print(F("Window: samples = "));
+  Serial.print(summary->count);
+  Serial.print(F(" ; min/mean/max = "));
+  Serial.print(summary->min);
+  Serial.print(F("/"));
+  Serial.print(summary->mean);
+  Serial.print(F("/"));
+  Serial.print(summary->max);
+  Serial.print(F(" ppm ; stddev = "));
+  Serial.print(summary->stddev);
+  Serial.print(F(" ppm ; ms per state ="));
+  for (uint8_t i = 0; i < ELGATE_STATE_COUNT; i++) {
+    Serial.print(F(" "));
+    Serial.print(summary->timeInState[i]);
+  }
+  Serial.println();
 }
+#endif
 
 
-ELCOM_errorCode_t el_uartReceive(uint8_t *data)
+void readSample(void)
 {
-  // Here we have to clear the bufferRx otherwise el_uartWaitUntilReceived() would return instantly
-  memset(sensor.bufferRx, 0, ELCOM_DATA_BUFFER_SIZE);
+  static uint8_t samples = 0;
+  ELCOM_errorCode_t error_code;
+  ELICHENS_Sample_t sample;
+  ELGATE_state_t previousState;
+  ELGATE_action_t action = ELGATE_SUPPRESS;
+  uint32_t period;
+#if SAMPLE_WINDOW
+  ELWINDOW_summary_t summary;
+#endif
 
-  // Clear any incoming data in serial
-  while (sensorSerial.available()) {
-    sensorSerial.read();
-  }
-  
-  // Enables the selected software serial port to listen
-  sensorSerial.listen();
+  error_code = ELCOM_getSample(&sensor, &sample);
 
-  return ELCOM_NO_ERROR;
-}
+  if (ELCOM_NO_ERROR == error_code) {
+    previousState = statusGate.state;
+    action = ELGATE_update(&statusGate, &sample.data, millis());
+
+    if (previousState != statusGate.state) {
+      Serial.print(F("Sensor state "));
+      Serial.print(previousState);
+      Serial.print(F(" -> "));
+      Serial.print(statusGate.state);
+      Serial.print(F(", s spent in state so far = "));
+      Serial.println(ELGATE_getTimeInState(&statusGate, previousState, millis()) / 1000);
+    }
 
+#if SAMPLE_WINDOW
+    if (ELWINDOW_update(&sampleWindow, &sample.data, millis(), &summary)) {
+      printSummary(&summary);
+    }
+#endif
 
-ELCOM_errorCode_t el_uartWaitUntilReceived(void)
-{
-  uint32_t start = millis();
-  uint8_t i = 0;
+    // Adaptive rate while the data is reliable, the gate's period otherwise
+    period = (ELGATE_STATE_READY == statusGate.state)
+        ? ELRATE_update(&sampleRate, sample.data.value, millis()) : ELGATE_getPeriod(&statusGate);
+  }
 
-  while (millis() - start < 250) {
-    while (sensorSerial.available()) {
-      sensor.bufferRx[i++] = sensorSerial.read();
+  if (ELCOM_NO_ERROR == error_code && ELGATE_SUPPRESS != action) {
+    int32_t filtered = ELFILTER_update(&ppmFilter, sample.data.value);
+
+    // Only what changed, and a heartbeat
+    if (ELREPORT_update(&ppmReport, &sample.data, millis())) {
+#if UPLINK_BATCH
+      ELBATCH_add(&uplinkBatch, &sample, millis());
+#else
+      Serial.print(F("time = "));
+      Serial.print(sample.runtime);
+      Serial.print(F(" ; ppm = "));
+      Serial.print(sample.data.value);
+      Serial.print(F(" ; filtered = "));
+      Serial.print(filtered);
+      Serial.print(F(" ; degC = "));
+      Serial.print(sample.temperature / 100.);
+      Serial.println((ELGATE_FLAG == action) ? F(" ; unreliable") : F(""));
+#endif
     }
-    
-    if (ELCOM_isResponseComplete(sensor.bufferRx)) {
-      return ELCOM_NO_ERROR;
+
+    // Confirm a crossing at the next refresh of the sensor rather than at the next period:
+    // reading it again before would only repeat the same measurement
+    if (ELALARM_CONFIRM == ELALARM_update(&ppmAlarm, sample.data.value, millis())) {
+      period = ALARM_CONFIRM_MS;
     }
-    // Continue waiting
+  }
+  else if (ELCOM_NO_ERROR != error_code) {
+    Serial.println(F("Failed to read sensor value"));
   }
 
-  Serial.println("Receive data timed out");
-  return ELCOM_SLAVE_TIMEOUT;
+  if (ELCOM_NO_ERROR == error_code && period != sampleSchedule.period) {
+    ELSCHED_setPeriod(&sampleSchedule, period);
+  }
+
+#if CHANGE_DETECTOR
+  // The baseline of the change detector must not learn from unreliable samples
+  if (ELCOM_NO_ERROR == error_code && ELGATE_ACCEPT == action) {
+    uint8_t flags = ELCHANGE_update(&ppmChange, sample.data.value);
+
+    if (flags != ppmChangeFlags) {
+      Serial.print(flags ? F("Change detected at ") : F("Change over at "));
+      Serial.print(sample.data.value);
+      Serial.print(F(" ppm, baseline = "));
+      Serial.println(ppmChange.baseline >> ELCHANGE_FRACTION_BITS);
+      ppmChangeFlags = flags;
+    }
+  }
+#endif
+
+#if UPLINK_BATCH
+  // Reports may stop for a while: do not hold the last ones back
+  ELBATCH_poll(&uplinkBatch, millis());
+#endif
+
+  if (++samples == STATS_PERIOD) {
+    samples = 0;
+    printStats();
+  }
 }
 
 
-void el_uartAbortReceive(void)
+void alarmCallback(ELALARM_alarm_t *alarm, uint8_t flag, uint8_t raised, int32_t value)
 {
-  // Just clear the serial
-  while (sensorSerial.available()) {
-    sensorSerial.read();
+  Serial.print(F("ALARM "));
+  Serial.print((ELALARM_HIGH_HIGH == flag) ? F("high-high") : (ELALARM_HIGH == flag) ? F("high") : F("rate-of-rise"));
+  Serial.print(raised ? F(" raised at ") : F(" cleared at "));
+  Serial.print(value);
+  Serial.println(F(" ppm"));
+
+#if UPLINK_BATCH
+  // Do not keep the samples leading to an alarm waiting
+  if (raised) {
+    ELBATCH_flush(&uplinkBatch, ELBATCH_FLAG_ALARM);
   }
+#endif
+}
+
+
+#if UPLINK_BATCH
+void uplinkSend(const uint8_t *frame, uint16_t size)
+{
+  Serial.write(frame, size);
+}
+#endif
+
+
+uint32_t el_getTick(void)
+{
+  return millis();
 }
@@ -0,0 +1,162 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include "elAlarm.h"
+
+#include <string.h>
+
+
+/**
+ * Condition of a threshold alarm, with the hysteresis once raised.
+ */
+static uint8_t ELALARM_checkThreshold(const ELALARM_alarm_t *alarm, uint8_t flag, int32_t threshold, int32_t value)
+{
+	if (0 == threshold) {
+		return 0;
+	}
+	if (alarm->active & flag) {
+		return (value > threshold - alarm->hysteresis) ? flag : 0;
+	}
+	return (value >= threshold) ? flag : 0;
+}
+
+
+/**
+ * Condition of the rate-of-rise alarm, measured from a reference at least ELALARM_RISE_INTERVAL old.
+ * Burst samples taken before the sensor refreshes its measure keep the previous verdict.
+ */
+static uint8_t ELALARM_checkRise(ELALARM_alarm_t *alarm, int32_t value, uint32_t now)
+{
+	uint32_t elapsed = now - alarm->riseTime;
+	int32_t rise = value - alarm->riseValue;
+
+	if (0 == alarm->riseLimit || elapsed < ELALARM_RISE_INTERVAL) {
+		return (0 == alarm->riseLimit) ? 0 : alarm->rising;
+	}
+
+	if (alarm->active & ELALARM_RISE) {
+		alarm->rising = (rise > 0) ? ELALARM_RISE : 0;
+	}
+	else {
+		alarm->rising = (rise > 0 && (uint64_t)rise * 1000 >= (uint64_t)alarm->riseLimit * elapsed) ? ELALARM_RISE : 0;
+	}
+
+	alarm->riseValue = value;
+	alarm->riseTime = now;
+
+	return alarm->rising;
+}
+
+
+/**
+ * Report the alarms going from one state to the other.
+ */
+static void ELALARM_notify(ELALARM_alarm_t *alarm, uint8_t flags, uint8_t raised, int32_t value)
+{
+	uint8_t flag;
+
+	if (NULL == alarm->callback) {
+		return;
+	}
+
+	for (flag = ELALARM_HIGH; flag <= ELALARM_RISE; flag <<= 1) {
+		if (flags & flag) {
+			alarm->callback(alarm, flag, raised, value);
+		}
+	}
+}
+
+
+/**
+ *   @brief  Configure the alarms of a sensor, none being raised
+ *   @param  alarm       Alarms to initialize
+ *   @param  high        High threshold in ppm, 0 to disable
+ *   @param  highHigh    High-high threshold in ppm, 0 to disable
+ *   @param  hysteresis  Drop below a threshold clearing its alarm, in ppm
+ *   @param  riseLimit   Rate-of-rise in ppm per 1000 ticks (ppm/s with ms ticks), 0 to disable
+ *   @param  callback    Called when an alarm is raised or cleared (NULL if unused)
+ **/
+void ELALARM_init(ELALARM_alarm_t *alarm, int32_t high, int32_t highHigh, int32_t hysteresis, uint32_t riseLimit,
+		ELALARM_callback_t callback)
+{
+	memset(alarm, 0, sizeof(*alarm));
+
+	alarm->high = high;
+	alarm->highHigh = highHigh;
+	alarm->hysteresis = hysteresis;
+	alarm->riseLimit = riseLimit;
+	alarm->confirmSamples = ELALARM_CONFIRM_SAMPLES;
+	alarm->callback = callback;
+}
+
+
+/**
+ *   @brief  Check a new concentration against the alarms, raising and clearing them
+ *   @param  alarm  Alarms of the sensor
+ *   @param  value  Concentration in ppm
+ *   @param  now    Current time in ticks
+ *   @return ELALARM_CONFIRM if an alarm awaits confirmation: sample again at the next sensor refresh, 0 otherwise
+ **/
+uint8_t ELALARM_update(ELALARM_alarm_t *alarm, int32_t value, uint32_t now)
+{
+	uint8_t conditions;
+	uint8_t pending;
+	uint8_t cleared;
+
+	if (!alarm->primed) {
+		alarm->primed = 1;
+		alarm->riseValue = value;
+		alarm->riseTime = now;
+	}
+
+	conditions = ELALARM_checkThreshold(alarm, ELALARM_HIGH, alarm->high, value)
+			| ELALARM_checkThreshold(alarm, ELALARM_HIGH_HIGH, alarm->highHigh, value)
+			| ELALARM_checkRise(alarm, value, now);
+
+	// Clearing is immediate, the hysteresis prevents flapping
+	cleared = alarm->active & ~conditions;
+	if (cleared) {
+		alarm->active &= ~cleared;
+		ELALARM_notify(alarm, cleared, 0, value);
+	}
+
+	pending = conditions & ~alarm->active;
+	if (!pending) {
+		alarm->confirming = 0;
+		return 0;
+	}
+
+	if (++alarm->confirming < alarm->confirmSamples) {
+		return ELALARM_CONFIRM;
+	}
+
+	alarm->confirming = 0;
+	alarm->active |= pending;
+	ELALARM_notify(alarm, pending, 1, value);
+
+	return 0;
+}
@@ -0,0 +1,340 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include "elBatch.h"
+
+#include <string.h>
+#include "crc_el.h"
+
+
+#define ELBATCH_LZ_MIN_MATCH			(3)
+#define ELBATCH_LZ_MAX_MATCH			(ELBATCH_LZ_MIN_MATCH + 0x7F)
+#define ELBATCH_LZ_MAX_LITERALS			(0x80)
+#define ELBATCH_LZ_MAX_OFFSET			(256)
+
+
+/********************************************************************
+ * Internal
+ ********************************************************************/
+
+#if ELBATCH_COMPRESSION
+static uint8_t ELBATCH_hash(const uint8_t *data)
+{
+	uint32_t value = (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16);
+
+	return (uint8_t)((uint32_t)(value * (uint32_t)2654435761UL) >> (32 - ELBATCH_LZ_HASH_BITS));
+}
+
+
+/**
+ * Write the literals from start to end, returns the new output size or 0 if they do not fit.
+ */
+static uint16_t ELBATCH_putLiterals(const uint8_t *data, uint16_t start, uint16_t end,
+		uint8_t *dataOut, uint16_t size, uint16_t sizeOut)
+{
+	uint16_t count;
+
+	while (start < end) {
+		count = end - start;
+		count = (count > ELBATCH_LZ_MAX_LITERALS) ? ELBATCH_LZ_MAX_LITERALS : count;
+		if (size + 1 + count > sizeOut) {
+			return 0;
+		}
+		dataOut[size++] = (uint8_t)(count - 1);
+		memcpy(&dataOut[size], &data[start], count);
+		size += count;
+		start += count;
+	}
+
+	return size;
+}
+
+
+/**
+ * LZ77 with 1 byte offsets and a single candidate per hash: small and fast rather than tight.
+ * Returns the compressed size, 0 if it would not be smaller than sizeOut.
+ */
+static uint16_t ELBATCH_compress(const uint8_t *data, uint16_t size, uint8_t *dataOut, uint16_t sizeOut)
+{
+	uint8_t table[1 << ELBATCH_LZ_HASH_BITS];	// Position + 1 of the last occurrence of each hash
+	uint16_t position = 0, literals = 0, out = 0;
+	uint16_t candidate, length;
+	uint8_t hash;
+
+	memset(table, 0, sizeof(table));
+
+	while (position + ELBATCH_LZ_MIN_MATCH <= size) {
+		hash = ELBATCH_hash(&data[position]);
+		candidate = table[hash];
+		table[hash] = (uint8_t)(position + 1);
+
+		if (0 == candidate--
+				|| position - candidate > ELBATCH_LZ_MAX_OFFSET
+				|| 0 != memcmp(&data[candidate], &data[position], ELBATCH_LZ_MIN_MATCH)) {
+			position++;
+			continue;
+		}
+
+		length = ELBATCH_LZ_MIN_MATCH;
+		while (position + length < size && length < ELBATCH_LZ_MAX_MATCH
+				&& data[candidate + length] == data[position + length]) {
+			length++;
+		}
+
+		if (literals < position) {
+			out = ELBATCH_putLiterals(data, literals, position, dataOut, out, sizeOut);
+			if (0 == out) {
+				return 0;
+			}
+		}
+		if (out + 2 > sizeOut) {
+			return 0;
+		}
+		dataOut[out++] = (uint8_t)(0x80 | (length - ELBATCH_LZ_MIN_MATCH));
+		dataOut[out++] = (uint8_t)(position - candidate - 1);
+
+		position += length;
+		literals = position;
+	}
+
+	if (literals < size) {
+		out = ELBATCH_putLiterals(data, literals, size, dataOut, out, sizeOut);
+	}
+
+	return out;
+}
+#endif
+
+
+/**
+ * Expand an LZ payload, returns its size or 0 if it is corrupted or does not fit.
+ */
+static uint16_t ELBATCH_decompress(const uint8_t *data, uint16_t size, uint8_t *dataOut, uint16_t sizeOut)
+{
+	uint16_t position = 0, out = 0;
+	uint16_t count, offset;
+	uint8_t token;
+
+	while (position < size) {
+		token = data[position++];
+
+		if (token < 0x80) {
+			count = token + 1;
+			if (position + count > size || out + count > sizeOut) {
+				return 0;
+			}
+			memcpy(&dataOut[out], &data[position], count);
+			position += count;
+			out += count;
+		}
+		else {
+			count = (token & 0x7F) + ELBATCH_LZ_MIN_MATCH;
+			if (position >= size) {
+				return 0;
+			}
+			offset = data[position++] + 1;
+			if (offset > out || out + count > sizeOut) {
+				return 0;
+			}
+			// Byte by byte: the match may overlap its own output
+			while (count--) {
+				dataOut[out] = dataOut[out - offset];
+				out++;
+			}
+		}
+	}
+
+	return out;
+}
+
+
+/********************************************************************
+ * Public functions
+ ********************************************************************/
+
+/**
+ *   @brief  Start batching
+ *   @param  batch       Batch to initialize
+ *   @param  maxSamples  Samples sent in one frame at most, up to ELSTORE_BLOCK_SAMPLES
+ *   @param  maxAge      Longest wait of a sample before being sent in ticks, 0 to disable
+ *   @param  compress    1 to compress the frames when it makes them smaller (needs ELBATCH_COMPRESSION)
+ *   @param  send        Callback sending a frame, which is only valid during the call
+ **/
+void ELBATCH_init(ELBATCH_batch_t *batch, uint8_t maxSamples, uint32_t maxAge, uint8_t compress,
+		void (*send)(const uint8_t *frame, uint16_t size))
+{
+	memset(batch, 0, sizeof(*batch));
+	ELSTORE_blockInit(&batch->block);
+
+	batch->maxSamples = (0 == maxSamples || maxSamples > ELSTORE_BLOCK_SAMPLES) ? ELSTORE_BLOCK_SAMPLES : maxSamples;
+	batch->maxAge = maxAge;
+	batch->compress = compress;
+	batch->send = send;
+}
+
+
+/**
+ *   @brief  Add a sample to the batch, then send the batch if it is full or too old
+ *   @param  batch   Batch to add to
+ *   @param  sample  Sample to send
+ *   @param  now     Current time in ticks
+ *   @return 1 if a frame was sent, 0 otherwise
+ **/
+uint8_t ELBATCH_add(ELBATCH_batch_t *batch, const ELICHENS_Sample_t *sample, uint32_t now)
+{
+	uint8_t sent = 0;
+
+	// The frame must still hold the block whatever the sample
+	if (ELSTORE_blockSize(&batch->block) + ELBATCH_SAMPLE_MAX_SIZE > ELBATCH_PAYLOAD_MAX_SIZE) {
+		sent = ELBATCH_flush(batch, ELBATCH_FLAG_SIZE);
+	}
+
+	if (0 == batch->block.count) {
+		batch->firstTime = now;
+	}
+	ELSTORE_blockAppend(&batch->block, sample);
+
+	if (batch->block.count >= batch->maxSamples) {
+		sent |= ELBATCH_flush(batch, ELBATCH_FLAG_SIZE);
+	}
+	else {
+		sent |= ELBATCH_poll(batch, now);
+	}
+
+	return sent;
+}
+
+
+/**
+ *   @brief  Send the batch if its first sample waited too long, to call when no sample comes
+ *   @param  batch  Batch to check
+ *   @param  now    Current time in ticks
+ *   @return 1 if a frame was sent, 0 otherwise
+ **/
+uint8_t ELBATCH_poll(ELBATCH_batch_t *batch, uint32_t now)
+{
+	if (0 == batch->block.count || 0 == batch->maxAge || now - batch->firstTime < batch->maxAge) {
+		return 0;
+	}
+
+	return ELBATCH_flush(batch, ELBATCH_FLAG_AGE);
+}
+
+
+/**
+ *   @brief  Send the samples of the batch now
+ *   @param  batch   Batch to send
+ *   @param  reason  ELBATCH_FLAG_ALARM, ELBATCH_FLAG_REQUEST... carried in the frame
+ *   @return 1 if a frame was sent, 0 if the batch was empty
+ **/
+uint8_t ELBATCH_flush(ELBATCH_batch_t *batch, uint8_t reason)
+{
+	uint8_t *payload = &batch->frame[ELBATCH_FRAME_HEADER_SIZE];
+	uint16_t count = batch->block.count;
+	uint16_t size, crc;
+	uint8_t flags = reason & (uint8_t)~ELBATCH_FLAG_LZ;
+
+	size = ELSTORE_blockSeal(&batch->block, payload, ELBATCH_PAYLOAD_MAX_SIZE);
+	if (0 == size) {
+		return 0;
+	}
+	batch->bytesRaw += size;
+
+#if ELBATCH_COMPRESSION
+	if (batch->compress) {
+		uint16_t packed = ELBATCH_compress(payload, size, batch->packed, size - 1);
+
+		if (0 != packed) {
+			memcpy(payload, batch->packed, packed);
+			size = packed;
+			flags |= ELBATCH_FLAG_LZ;
+		}
+	}
+#endif
+
+	batch->frame[0] = ELBATCH_FRAME_SYNC;
+	batch->frame[1] = flags;
+	batch->frame[2] = (uint8_t)size;
+	batch->frame[3] = (uint8_t)(size >> 8);
+
+	size += ELBATCH_FRAME_HEADER_SIZE;
+	crc = CRC_computeCRC(batch->frame, size);
+	batch->frame[size++] = (uint8_t)crc;
+	batch->frame[size++] = (uint8_t)(crc >> 8);
+
+	batch->send(batch->frame, size);
+
+	batch->frames++;
+	batch->samples += count;
+	batch->bytesSent += size;
+
+	return 1;
+}
+
+
+/**
+ *   @brief  Check a received frame and extract its elStore block, e.g. on a gateway
+ *   @param  frame      Frame, starting with ELBATCH_FRAME_SYNC
+ *   @param  size       Bytes available in frame
+ *   @param  blockOut   Destination of the block, to read with ELSTORE_readerInit()
+ *   @param  blockSize  Size of blockOut, ELBATCH_PAYLOAD_MAX_SIZE is always enough
+ *   @param  flags      Filled with the FLAGS of the frame, may be NULL
+ *   @return the size of the block, 0 if the frame is incomplete, corrupted or too large
+ **/
+uint16_t ELBATCH_decodeFrame(const uint8_t *frame, uint16_t size, uint8_t *blockOut, uint16_t blockSize, uint8_t *flags)
+{
+	uint16_t length, crc;
+
+	if (size < ELBATCH_FRAME_HEADER_SIZE + ELBATCH_FRAME_CRC_SIZE || ELBATCH_FRAME_SYNC != frame[0]) {
+		return 0;
+	}
+
+	length = (uint16_t)(frame[2] | (frame[3] << 8));
+	if (size < ELBATCH_FRAME_HEADER_SIZE + length + ELBATCH_FRAME_CRC_SIZE) {
+		return 0;
+	}
+
+	crc = (uint16_t)(frame[ELBATCH_FRAME_HEADER_SIZE + length] | (frame[ELBATCH_FRAME_HEADER_SIZE + length + 1] << 8));
+	if (crc != CRC_computeCRC((uint8_t *)frame, ELBATCH_FRAME_HEADER_SIZE + length)) {
+		return 0;
+	}
+
+	if (NULL != flags) {
+		*flags = frame[1];
+	}
+
+	if (frame[1] & ELBATCH_FLAG_LZ) {
+		return ELBATCH_decompress(&frame[ELBATCH_FRAME_HEADER_SIZE], length, blockOut, blockSize);
+	}
+
+	if (length > blockSize) {
+		return 0;
+	}
+	memcpy(blockOut, &frame[ELBATCH_FRAME_HEADER_SIZE], length);
+
+	return length;
+}
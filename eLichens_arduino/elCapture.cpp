@@ -0,0 +1,301 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include "elCapture.h"
+
+#include <string.h>
+
+
+/********************************************************************
+ * Internal
+ ********************************************************************/
+
+static void ELCAP_ringPut(ELCAP_capture_t *capture, const uint8_t *data, uint16_t length)
+{
+	while (length--) {
+		capture->buffer[capture->head++] = *data++;
+		if (capture->head == capture->size) {
+			capture->head = 0;
+		}
+	}
+}
+
+
+static uint16_t ELCAP_ringRecordSize(ELCAP_capture_t *capture, uint16_t position)
+{
+	position = (position + 1) % capture->size; // LEN follows TYPE
+	return ELCAP_RECORD_HEADER_SIZE + capture->buffer[position];
+}
+
+
+static uint32_t ELCAP_readUint32(const uint8_t *data)
+{
+	return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+
+/********************************************************************
+ * Capture
+ ********************************************************************/
+
+/**
+ *   @brief  Use a RAM buffer as capture storage. Once full, the oldest records are overwritten.
+ *   @param  capture  Capture to initialise
+ *   @param  buffer   Storage for the records
+ *   @param  size     Size of buffer in bytes
+ **/
+void ELCAP_initRing(ELCAP_capture_t *capture, uint8_t *buffer, uint16_t size)
+{
+	capture->buffer = buffer;
+	capture->size = size;
+	capture->head = 0;
+	capture->tail = 0;
+	capture->used = 0;
+	capture->overwritten = 0;
+	capture->write = NULL;
+}
+
+
+/**
+ *   @brief  Append a record to the capture
+ *   @param  capture    Capture to append to (nothing is done if NULL)
+ *   @param  type       ELCAP_RECORD_TX, ELCAP_RECORD_RX or ELCAP_RECORD_RX_TIMEOUT
+ *   @param  timestamp  Monotonic time in ms
+ *   @param  data       Frame bytes
+ *   @param  length     Number of bytes in data
+ **/
+void ELCAP_record(ELCAP_capture_t *capture, uint8_t type, uint32_t timestamp, const uint8_t *data, uint8_t length)
+{
+	uint8_t header[ELCAP_RECORD_HEADER_SIZE];
+	uint16_t recordSize = ELCAP_RECORD_HEADER_SIZE + length;
+
+	if (NULL == capture) {
+		return;
+	}
+
+	header[0] = type;
+	header[1] = length;
+	header[2] = (uint8_t)timestamp;
+	header[3] = (uint8_t)(timestamp >> 8);
+	header[4] = (uint8_t)(timestamp >> 16);
+	header[5] = (uint8_t)(timestamp >> 24);
+
+	if (NULL != capture->write) {
+		capture->write(header, ELCAP_RECORD_HEADER_SIZE);
+		capture->write(data, length);
+		return;
+	}
+
+	if (recordSize > capture->size) {
+		capture->overwritten++;
+		return; // Can never fit
+	}
+
+	// Make room by dropping the oldest records
+	while (capture->size - capture->used < recordSize) {
+		uint16_t oldest = ELCAP_ringRecordSize(capture, capture->tail);
+		capture->tail = (capture->tail + oldest) % capture->size;
+		capture->used -= oldest;
+		capture->overwritten++;
+	}
+
+	ELCAP_ringPut(capture, header, ELCAP_RECORD_HEADER_SIZE);
+	ELCAP_ringPut(capture, data, length);
+	capture->used += recordSize;
+}
+
+
+/**
+ *   @brief  Move whole records out of the RAM ring, oldest first
+ *   @param  capture  Capture to read from
+ *   @param  dataOut  Destination buffer
+ *   @param  size     Size of dataOut in bytes
+ *   @return number of bytes written to dataOut
+ **/
+uint16_t ELCAP_readRing(ELCAP_capture_t *capture, uint8_t *dataOut, uint16_t size)
+{
+	uint16_t count = 0;
+
+	while (capture->used > 0) {
+		uint16_t recordSize = ELCAP_ringRecordSize(capture, capture->tail);
+
+		if (count + recordSize > size) {
+			break;
+		}
+
+		while (recordSize--) {
+			dataOut[count++] = capture->buffer[capture->tail++];
+			if (capture->tail == capture->size) {
+				capture->tail = 0;
+			}
+			capture->used--;
+		}
+	}
+
+	return count;
+}
+
+
+/**
+ *   @brief  Iterate over the records of a linear capture (file content or ELCAP_readRing output)
+ *   @param  data    Capture bytes
+ *   @param  size    Number of bytes in data
+ *   @param  offset  Position of the record to read, advanced to the next one
+ *   @param  record  Decoded record
+ *   @return 1 if a record was decoded, 0 at the end of the capture or on a truncated record
+ **/
+uint8_t ELCAP_nextRecord(const uint8_t *data, uint32_t size, uint32_t *offset, ELCAP_record_t *record)
+{
+	const uint8_t *header = &data[*offset];
+
+	if (*offset + ELCAP_RECORD_HEADER_SIZE > size
+			|| *offset + ELCAP_RECORD_HEADER_SIZE + header[1] > size) {
+		return 0;
+	}
+
+	record->type = header[0];
+	record->length = header[1];
+	record->timestamp = ELCAP_readUint32(&header[2]);
+	record->data = &header[ELCAP_RECORD_HEADER_SIZE];
+
+	*offset += ELCAP_RECORD_HEADER_SIZE + record->length;
+
+	return 1;
+}
+
+
+/********************************************************************
+ * Replay
+ ********************************************************************/
+
+static const uint8_t *replayData;
+static uint32_t replaySize;
+static uint32_t replayOffset;
+static uint32_t replayTick;
+static uint8_t *replayBufferRx;
+static volatile uint16_t *replayRxLength;
+
+
+/**
+ *   @brief  Start feeding a capture back through the replay callbacks
+ *   @param  data  Capture bytes
+ *   @param  size  Number of bytes in data
+ *   @param  rxLength  Receive count to update, as a transport would (&sensor.rxLength)
+ **/
+void ELCAP_replayBegin(const uint8_t *data, uint32_t size, volatile uint16_t *rxLength)
+{
+	replayData = data;
+	replayRxLength = rxLength;
+	replaySize = size;
+	replayOffset = 0;
+	replayTick = 0;
+	replayBufferRx = NULL;
+}
+
+
+/**
+ *   @brief  Peek at the command of the next transmitted frame, to know which decoder to call
+ *   @return the command code, 0 once the capture is exhausted
+ **/
+uint8_t ELCAP_replayNextCommand(void)
+{
+	ELCAP_record_t record;
+	uint32_t offset = replayOffset;
+
+	while (ELCAP_nextRecord(replayData, replaySize, &offset, &record)) {
+		if (ELCAP_RECORD_TX == record.type && record.length > ELCOM_FIELD_CMD_POS) {
+			return record.data[ELCOM_FIELD_CMD_POS];
+		}
+	}
+
+	return 0;
+}
+
+
+ELCOM_errorCode_t ELCAP_replayTransmit(uint8_t *data, uint16_t size)
+{
+	ELCAP_record_t record;
+
+	// The frame is not compared: the caller replays the commands of the capture
+	(void)data;
+	(void)size;
+
+	while (ELCAP_nextRecord(replayData, replaySize, &replayOffset, &record)) {
+		if (ELCAP_RECORD_TX == record.type) {
+			replayTick = record.timestamp;
+			return ELCOM_NO_ERROR;
+		}
+	}
+
+	return ELCOM_SLAVE_ERROR; // End of capture
+}
+
+
+ELCOM_errorCode_t ELCAP_replayReceive(uint8_t *data)
+{
+	replayBufferRx = data;
+	return ELCOM_NO_ERROR;
+}
+
+
+ELCOM_errorCode_t ELCAP_replayWaitUntilReceived(void)
+{
+	ELCAP_record_t record;
+	uint32_t offset = replayOffset;
+
+	// The response must directly follow its request
+	if (!ELCAP_nextRecord(replayData, replaySize, &offset, &record)
+			|| (ELCAP_RECORD_RX != record.type && ELCAP_RECORD_RX_TIMEOUT != record.type)) {
+		return ELCOM_SLAVE_TIMEOUT;
+	}
+
+	replayOffset = offset;
+	replayTick = record.timestamp;
+
+	if (ELCAP_RECORD_RX_TIMEOUT == record.type || 0 == record.length) {
+		return ELCOM_SLAVE_TIMEOUT; // Nothing or only part of the response was received
+	}
+
+	memcpy(replayBufferRx, record.data, record.length);
+	if (NULL != replayRxLength) {
+		*replayRxLength = record.length;
+	}
+
+	return ELCOM_NO_ERROR;
+}
+
+
+void ELCAP_replayAbortReceive(void)
+{
+	replayBufferRx = NULL;
+}
+
+
+uint32_t ELCAP_replayGetTick(void)
+{
+	return replayTick;
+}
@@ -0,0 +1,107 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#ifndef __ELCHANGE_H
+#define __ELCHANGE_H
+
+#include <stdint.h>
+
+
+/********************************************************************
+ * Detector parameters
+ ********************************************************************/
+
+#define ELCHANGE_FRACTION_BITS			(8)		// Fractional bits of the states and limits
+#define ELCHANGE_BASELINE_SHIFT			(10)	// Baseline averaged over about 2^10 samples
+#define ELCHANGE_EWMA_SHIFT				(3)		// EWMA chart, lambda = 1/2^3
+
+
+/********************************************************************
+ * Change-point detection
+ *
+ * Flags small sustained increases of the concentration, well below
+ * the alarm thresholds, with two control charts against a slow
+ * baseline of the concentration:
+ *
+ *   CUSUM: S = max(0, S + x - baseline - allowance), flags S > cusumLimit
+ *   EWMA:  z = z + (x - z) / 2^ewmaShift, flags z - baseline > ewmaLimit
+ *
+ * The baseline stops following the concentration while S is above
+ * half its limit, so that a slow leak does not become the new normal.
+ * A CUSUM verdict holds until S is back to 0, an EWMA one until z is
+ * back under half its limit. All values are in ppm
+ * with ELCHANGE_FRACTION_BITS, in 32-bit integers.
+ *
+ * ELCHANGE_detector_t holds a single stream (MCU). A gateway keeps its
+ * streams in ELCHANGE_batch_t, one array per state, sharing one
+ * configuration: ELCHANGE_updateBatch() is a branch-free loop that the
+ * compiler can vectorize. Both give the same results.
+ ********************************************************************/
+
+#define ELCHANGE_CUSUM					(1<<0)
+#define ELCHANGE_EWMA					(1<<1)
+
+typedef struct {
+	int32_t			allowance;										// CUSUM slack k, shifts smaller than it are ignored
+	int32_t			cusumLimit;										// CUSUM decision interval h
+	int32_t			ewmaLimit;										// EWMA distance to the baseline
+	uint8_t			ewmaShift;
+	uint8_t			baselineShift;
+} ELCHANGE_config_t;
+
+typedef struct {
+	ELCHANGE_config_t	config;
+	int32_t				baseline;
+	int32_t				cusum;
+	int32_t				ewma;
+	uint8_t				flags;
+	uint8_t				primed;
+} ELCHANGE_detector_t;
+
+typedef struct {
+	const ELCHANGE_config_t	*config;
+	uint32_t				count;									// Streams
+	int32_t					*baseline;								// Arrays of count states, owned by the caller
+	int32_t					*cusum;
+	int32_t					*ewma;
+	uint8_t					*flags;									// Verdicts of the last update
+} ELCHANGE_batch_t;
+
+
+/********************************************************************
+ * Public functions
+ ********************************************************************/
+
+void ELCHANGE_initConfig(ELCHANGE_config_t *config, uint32_t allowance, uint32_t cusumLimit, uint32_t ewmaLimit);
+void ELCHANGE_init(ELCHANGE_detector_t *detector, uint32_t allowance, uint32_t cusumLimit, uint32_t ewmaLimit);
+uint8_t ELCHANGE_update(ELCHANGE_detector_t *detector, int32_t value);
+
+void ELCHANGE_startBatch(ELCHANGE_batch_t *batch, const int32_t *values);
+void ELCHANGE_updateBatch(ELCHANGE_batch_t *batch, const int32_t *values);
+
+
+#endif /* __ELCHANGE_H */
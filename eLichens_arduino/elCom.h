@@ -79,6 +79,7 @@
 #define ELCOM_FIELD_HEADER_SIZE				 (ELCOM_FIELD_START_OF_PACKET_SIZE + ELCOM_FIELD_VER_SIZE + ELCOM_FIELD_CMD_SIZE + ELCOM_FIELD_LEN_SIZE)
 #define ELCOM_FIELD_FOOTER_SIZE			     (ELCOM_FIELD_CRC_SIZE + ELCOM_FIELD_END_OF_PACKET_SIZE)
 #define ELCOM_FIELD_DATA_MAX_SIZE            (ELCOM_DATA_BUFFER_SIZE-ELCOM_FIELD_CMD_SIZE-ELCOM_FIELD_CRC_SIZE-ELCOM_FIELD_END_OF_PACKET_SIZE)
+#define ELCOM_FIELD_LEN_MAX_VALUE            (ELCOM_DATA_BUFFER_SIZE-ELCOM_FIELD_HEADER_SIZE-ELCOM_FIELD_FOOTER_SIZE) // Largest LEN of a frame fitting the buffer
 
 
 /********************************************************************
@@ -126,9 +127,20 @@ typedef enum {
 	ELCOM_COMMAND_UNKNOW		= 0x05,
 	ELCOM_SLAVE_TIMEOUT			= 0x06,
 	ELCOM_SLAVE_ERROR			= 0x07,
+	ELCOM_INVALID_LEN			= 0x08,
 } ELCOM_errorCode_t;
 
 
+/**
+ *   @enum  ELCOM_responseState State of a response being received, see ELCOM_getResponseState()
+ **/
+typedef enum {
+	ELCOM_RESPONSE_INCOMPLETE	= 0x00,		// Keep receiving
+	ELCOM_RESPONSE_COMPLETE		= 0x01,		// All the bytes announced by LEN are received
+	ELCOM_RESPONSE_INVALID		= 0x02,		// Cannot become a valid frame, stop receiving
+} ELCOM_responseState_t;
+
+
 /**
  *   @enum  ELCOM_slave_error_code Error code sent by the error slave command
  **/
@@ -157,7 +169,8 @@ typedef struct {
 ELCOM_errorCode_t ELCOM_parseReceivedPacket(uint8_t *dataBufferIn, ELCOM_packet_t *packetOut);
 uint8_t ELCOM_prepareSendPacket(ELCOM_packet_t *packetToSend, uint8_t *dataBufferOut);
 ELCOM_slaveErrorCode_t ELCOM_handleError(ELCOM_errorCode_t errorCode, ELCOM_packet_t *packetOut);
-uint8_t ELCOM_isResponseComplete(uint8_t *buffer);
+ELCOM_responseState_t ELCOM_getResponseState(const uint8_t *buffer, uint16_t count);
+uint8_t ELCOM_isResponseComplete(uint8_t *buffer);		// Deprecated: needs a zeroed buffer, use ELCOM_getResponseState()
 
 
 #endif
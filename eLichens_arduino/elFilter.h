@@ -0,0 +1,127 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#ifndef __ELFILTER_H
+#define __ELFILTER_H
+
+#include <stdint.h>
+
+
+/********************************************************************
+ * Filter parameters
+ ********************************************************************/
+
+#ifndef ELFILTER_WINDOW_MAX_SIZE
+#define ELFILTER_WINDOW_MAX_SIZE		(9)		// Largest window of the median and moving average stages
+#endif
+
+#define ELFILTER_FRACTION_BITS			(8)		// Fractional bits of the EMA and Kalman states
+
+
+/********************************************************************
+ * Filter chain
+ *
+ * A chain is an array of stages owned by the caller, each stage feeding
+ * the next one. Every stage runs in integer arithmetic on the ppm value
+ * and in constant time per sample (bounded by ELFILTER_WINDOW_MAX_SIZE
+ * for the median), without any allocation:
+ *
+ *   ELFILTER_EMA:     exponential moving average, alpha = 1 / 2^shift
+ *   ELFILTER_MEDIAN:  sliding median of the last size values
+ *   ELFILTER_AVERAGE: moving average of the last size values
+ *   ELFILTER_KALMAN:  1-D Kalman filter of a random walk, process and
+ *                     measurement noise variances in ppm^2
+ *
+ * Example, median of 3 to drop spikes then EMA with alpha = 1/4:
+ *
+ *   ELFILTER_stage_t stages[2];
+ *   ELFILTER_chain_t chain = { stages, 2 };
+ *
+ *   ELFILTER_initMedian(&stages[0], 3);
+ *   ELFILTER_initEma(&stages[1], 2);
+ *   filtered = ELFILTER_update(&chain, data.value);
+ ********************************************************************/
+
+typedef enum {
+	ELFILTER_EMA				= 0x00,
+	ELFILTER_MEDIAN				= 0x01,
+	ELFILTER_AVERAGE			= 0x02,
+	ELFILTER_KALMAN				= 0x03,
+} ELFILTER_type_t;
+
+typedef struct {
+	uint8_t			shift;
+	int32_t			state;											// Average with ELFILTER_FRACTION_BITS
+} ELFILTER_ema_t;
+
+typedef struct {
+	uint8_t			size;
+	uint8_t			count;											// Values in the window
+	uint8_t			head;											// Oldest value
+	int32_t			window[ELFILTER_WINDOW_MAX_SIZE];				// Values in arrival order
+	int32_t			sorted[ELFILTER_WINDOW_MAX_SIZE];				// Same values, sorted (median only)
+	int32_t			sum;											// Sum of the window (average only)
+} ELFILTER_window_t;
+
+typedef struct {
+	uint32_t		processNoise;									// Q, with ELFILTER_FRACTION_BITS
+	uint32_t		measurementNoise;								// R, with ELFILTER_FRACTION_BITS
+	uint32_t		variance;										// P, with ELFILTER_FRACTION_BITS, 0 before the first value
+	int32_t			state;											// Estimate with ELFILTER_FRACTION_BITS
+} ELFILTER_kalman_t;
+
+typedef struct {
+	ELFILTER_type_t	type;
+	union {
+		ELFILTER_ema_t		ema;
+		ELFILTER_window_t	window;
+		ELFILTER_kalman_t	kalman;
+	};
+	uint8_t			primed;											// A value went through the stage
+} ELFILTER_stage_t;
+
+typedef struct {
+	ELFILTER_stage_t	*stages;
+	uint8_t				count;
+} ELFILTER_chain_t;
+
+
+/********************************************************************
+ * Public functions
+ ********************************************************************/
+
+void ELFILTER_initEma(ELFILTER_stage_t *stage, uint8_t shift);
+void ELFILTER_initMedian(ELFILTER_stage_t *stage, uint8_t size);
+void ELFILTER_initAverage(ELFILTER_stage_t *stage, uint8_t size);
+void ELFILTER_initKalman(ELFILTER_stage_t *stage, uint16_t processNoise, uint16_t measurementNoise);
+
+int32_t ELFILTER_stageUpdate(ELFILTER_stage_t *stage, int32_t value);
+int32_t ELFILTER_update(ELFILTER_chain_t *chain, int32_t value);
+void ELFILTER_reset(ELFILTER_chain_t *chain);
+
+
+#endif /* __ELFILTER_H */
@@ -0,0 +1,134 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include "elGate.h"
+
+#include <string.h>
+
+
+/**
+ *   @brief  Start gating, the sensor being assumed ready until a sample says otherwise
+ *   @param  gate    Gate to initialize
+ *   @param  period  Polling period when the data is usable, ELGATE_SLOW_FACTOR times
+ *                   longer during warm-up and calibration
+ *   @param  now     Current time in ticks
+ **/
+void ELGATE_init(ELGATE_gate_t *gate, uint32_t period, uint32_t now)
+{
+	memset(gate, 0, sizeof(*gate));
+
+	gate->state = ELGATE_STATE_READY;
+	gate->stateSince = now;
+
+	gate->action[ELGATE_STATE_READY] = ELGATE_ACCEPT;
+	gate->action[ELGATE_STATE_WARMUP] = ELGATE_SUPPRESS;
+	gate->action[ELGATE_STATE_CALIBRATION] = ELGATE_SUPPRESS;
+	gate->action[ELGATE_STATE_LAMP] = ELGATE_FLAG;
+	gate->action[ELGATE_STATE_UNRELIABLE] = ELGATE_FLAG;
+
+	gate->period[ELGATE_STATE_READY] = period;
+	gate->period[ELGATE_STATE_WARMUP] = period * ELGATE_SLOW_FACTOR;
+	gate->period[ELGATE_STATE_CALIBRATION] = period * ELGATE_SLOW_FACTOR;
+	gate->period[ELGATE_STATE_LAMP] = period;
+	gate->period[ELGATE_STATE_UNRELIABLE] = period;
+}
+
+
+/**
+ *   @brief  State of the sensor according to a sample
+ *   @param  data  Sample read with ELCOM_getSenData()
+ *   @return the state, see elGate.h for the priorities
+ **/
+ELGATE_state_t ELGATE_classify(const ELICHENS_SensorData_t *data)
+{
+	if (data->status & ELCOM_STATUS_CALIBRATION) {
+		return ELGATE_STATE_CALIBRATION;
+	}
+	if (data->status & ELCOM_STATUS_WARMUP) {
+		return ELGATE_STATE_WARMUP;
+	}
+	if (data->status & ELCOM_STATUS_LAMP) {
+		return ELGATE_STATE_LAMP;
+	}
+	if ((data->status & ELCOM_STATUS_DATA_NOT_RELIABLE) || 0 != data->error) {
+		return ELGATE_STATE_UNRELIABLE;
+	}
+	return ELGATE_STATE_READY;
+}
+
+
+/**
+ *   @brief  Classify a sample, account for the time in state and decide what to do with it
+ *   @param  gate  Gate to update
+ *   @param  data  Sample read with ELCOM_getSenData()
+ *   @param  now   Current time in ticks
+ *   @return the action configured for the state of the sample
+ **/
+ELGATE_action_t ELGATE_update(ELGATE_gate_t *gate, const ELICHENS_SensorData_t *data, uint32_t now)
+{
+	ELGATE_state_t state = ELGATE_classify(data);
+
+	if (state != gate->state) {
+		gate->timeInState[gate->state] += now - gate->stateSince;
+		gate->state = state;
+		gate->stateSince = now;
+	}
+
+	gate->samples[state]++;
+
+	return gate->action[state];
+}
+
+
+/**
+ *   @brief  Polling period for the current state, e.g. for ELSCHED_setPeriod()
+ *   @param  gate  Gate to check
+ *   @return the period in ticks
+ **/
+uint32_t ELGATE_getPeriod(const ELGATE_gate_t *gate)
+{
+	return gate->period[gate->state];
+}
+
+
+/**
+ *   @brief  Total time spent in a state, including the current period
+ *   @param  gate   Gate to check
+ *   @param  state  State to check
+ *   @param  now    Current time in ticks
+ *   @return the time in ticks
+ **/
+uint32_t ELGATE_getTimeInState(const ELGATE_gate_t *gate, ELGATE_state_t state, uint32_t now)
+{
+	uint32_t time = gate->timeInState[state];
+
+	if (state == gate->state) {
+		time += now - gate->stateSince;
+	}
+
+	return time;
+}
@@ -0,0 +1,96 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#ifndef __ELGATE_H
+#define __ELGATE_H
+
+#include <stdint.h>
+#include "ELICHENS_driver.h"
+
+
+/********************************************************************
+ * Gate parameters
+ ********************************************************************/
+
+#define ELGATE_SLOW_FACTOR				(10)	// Polling slow down while the sensor warms up or calibrates
+
+
+/********************************************************************
+ * Status gating
+ *
+ * Classifies each sample from the ELCOM_STATUS_* bits and the error
+ * code of ELICHENS_SensorData_t, by decreasing priority:
+ *
+ *   CALIBRATION  ELCOM_STATUS_CALIBRATION   suppressed, slow polling
+ *   WARMUP       ELCOM_STATUS_WARMUP        suppressed, slow polling
+ *   LAMP         ELCOM_STATUS_LAMP          flagged
+ *   UNRELIABLE   ELCOM_STATUS_DATA_NOT_RELIABLE, or an error code
+ *                                           flagged
+ *   READY        none of the above          accepted
+ *
+ * The decision and the polling period of each state can be changed in
+ * the action[] and period[] fields after ELGATE_init(). The time spent
+ * in each state is accumulated in the caller's tick unit.
+ ********************************************************************/
+
+typedef enum {
+	ELGATE_STATE_READY			= 0x00,
+	ELGATE_STATE_WARMUP			= 0x01,
+	ELGATE_STATE_CALIBRATION	= 0x02,
+	ELGATE_STATE_LAMP			= 0x03,
+	ELGATE_STATE_UNRELIABLE		= 0x04,
+	ELGATE_STATE_COUNT
+} ELGATE_state_t;
+
+typedef enum {
+	ELGATE_ACCEPT				= 0x00,		// Reliable sample
+	ELGATE_FLAG					= 0x01,		// Keep the sample, marked as doubtful
+	ELGATE_SUPPRESS				= 0x02,		// Drop the sample: do not store nor transmit it
+} ELGATE_action_t;
+
+typedef struct {
+	ELGATE_state_t	state;
+	uint32_t		stateSince;										// Time of the entry in the current state
+	uint32_t		timeInState[ELGATE_STATE_COUNT];				// Time spent in the previous periods of each state
+	uint32_t		samples[ELGATE_STATE_COUNT];					// Samples classified in each state
+	ELGATE_action_t	action[ELGATE_STATE_COUNT];						// Decision for the samples of each state
+	uint32_t		period[ELGATE_STATE_COUNT];						// Polling period in each state
+} ELGATE_gate_t;
+
+
+/********************************************************************
+ * Public functions
+ ********************************************************************/
+
+void ELGATE_init(ELGATE_gate_t *gate, uint32_t period, uint32_t now);
+ELGATE_state_t ELGATE_classify(const ELICHENS_SensorData_t *data);
+ELGATE_action_t ELGATE_update(ELGATE_gate_t *gate, const ELICHENS_SensorData_t *data, uint32_t now);
+uint32_t ELGATE_getPeriod(const ELGATE_gate_t *gate);
+uint32_t ELGATE_getTimeInState(const ELGATE_gate_t *gate, ELGATE_state_t state, uint32_t now);
+
+
+#endif /* __ELGATE_H */
@@ -0,0 +1,176 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include "elMetrics.h"
+
+#include <string.h>
+
+
+/********************************************************************
+ * Internal
+ ********************************************************************/
+
+/**
+ * Order the accesses to the counters and to the sequence. A compiler
+ * barrier is enough on a single core, a host may run the driver and
+ * the reader of the snapshots on different cores.
+ */
+#ifndef ELMETRICS_BARRIER
+#ifdef __unix__
+#define ELMETRICS_BARRIER()		__sync_synchronize()
+#else
+#define ELMETRICS_BARRIER()		__asm__ __volatile__ ("" ::: "memory")
+#endif
+#endif
+
+
+const uint8_t ELMETRICS_commands[ELMETRICS_COMMAND_COUNT] = {
+	ELCOM_CMD_GET_MODEL_NAME, ELCOM_CMD_GET_PROD_NAME, ELCOM_CMD_GET_FW_VER, ELCOM_CMD_GET_SEN_SN,
+	ELCOM_CMD_GET_RUN_TIME, ELCOM_CMD_GET_PROD_DATE, ELCOM_CMD_GET_SEN_DATA, ELCOM_CMD_GET_SEN_TEMP,
+	ELCOM_CMD_GET_SEN_DATA_FMT, ELCOM_CMD_GET_SEN_NAME,
+};
+
+
+/********************************************************************
+ * Public functions
+ ********************************************************************/
+
+/**
+ *   @brief  Clear the counters
+ *   @param  metrics  Metrics to initialize
+ **/
+void ELMETRICS_init(ELMETRICS_metrics_t *metrics)
+{
+	memset(metrics, 0, sizeof(*metrics));
+}
+
+
+/**
+ *   @brief  Slot of a command in the transactions counters
+ *   @param  command  ELCOM command code
+ *   @return the index of the command in ELMETRICS_commands, ELMETRICS_COMMAND_OTHER if it is not there
+ **/
+uint8_t ELMETRICS_getCommandSlot(uint8_t command)
+{
+	uint8_t slot;
+
+	for (slot = 0; slot < ELMETRICS_COMMAND_COUNT; slot++) {
+		if (ELMETRICS_commands[slot] == command) {
+			break;
+		}
+	}
+
+	return slot;
+}
+
+
+/**
+ *   @brief  Account for a transaction, called by the driver
+ *   @param  metrics      Metrics to update
+ *   @param  transaction  What the transaction sent, received and returned
+ **/
+void ELMETRICS_record(ELMETRICS_metrics_t *metrics, const ELMETRICS_transaction_t *transaction)
+{
+	ELMETRICS_counters_t *counters = &metrics->counters;
+	uint8_t outcome = transaction->outcome;
+	uint8_t bin = 0;
+
+	metrics->sequence++;
+	ELMETRICS_BARRIER();
+
+	counters->transactions[ELMETRICS_getCommandSlot(transaction->command)]++;
+
+	if (outcome >= ELMETRICS_OUTCOME_COUNT) {
+		outcome = ELMETRICS_OUTCOME_COUNT - 1;
+	}
+	counters->outcomes[outcome]++;
+
+	counters->bytesTx += transaction->bytesTx;
+	counters->bytesRx += transaction->bytesRx;
+
+	if (metrics->lastFailed && metrics->lastCommand == transaction->command) {
+		counters->retries++;
+	}
+	metrics->lastCommand = transaction->command;
+	metrics->lastFailed = (ELCOM_NO_ERROR != transaction->outcome);
+
+	// Latency histogram, log2 bins
+	if (transaction->complete) {
+		if (transaction->latency > counters->latencyMax) {
+			counters->latencyMax = transaction->latency;
+		}
+		counters->latencySum += transaction->latency;
+		while (transaction->latency >> bin && bin < ELMETRICS_LATENCY_BINS - 1) {
+			bin++;
+		}
+		counters->latency[bin]++;
+	}
+
+	ELMETRICS_BARRIER();
+	metrics->sequence++;
+}
+
+
+/**
+ *   @brief  Copy the counters, consistent even if the driver updates them meanwhile
+ *   @param  metrics      Metrics to read
+ *   @param  countersOut  Copy of the counters
+ *   @return 1 if the copy is consistent, 0 if the counters kept changing (e.g. read
+ *           from an interrupt of the driver in the middle of an update)
+ **/
+uint8_t ELMETRICS_snapshot(const ELMETRICS_metrics_t *metrics, ELMETRICS_counters_t *countersOut)
+{
+	uint32_t sequence;
+	uint8_t tries;
+
+	for (tries = 0; tries < ELMETRICS_SNAPSHOT_TRIES; tries++) {
+		sequence = metrics->sequence;
+		ELMETRICS_BARRIER();
+		memcpy(countersOut, &metrics->counters, sizeof(*countersOut));
+		ELMETRICS_BARRIER();
+		if (0 == (sequence & 1) && sequence == metrics->sequence) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+
+/**
+ *   @brief  Clear the counters, from the context of the driver
+ *   @param  metrics  Metrics to reset
+ **/
+void ELMETRICS_reset(ELMETRICS_metrics_t *metrics)
+{
+	metrics->sequence++;
+	ELMETRICS_BARRIER();
+	memset(&metrics->counters, 0, sizeof(metrics->counters));
+	metrics->lastFailed = 0;
+	ELMETRICS_BARRIER();
+	metrics->sequence++;
+}
@@ -0,0 +1,112 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include "elRate.h"
+
+#include <string.h>
+
+
+#define ELRATE_DEVIATION_MAX			(0x7FFF)	// Deviations are clamped so that their square fits 32 bits
+#define ELRATE_CALM_SAMPLES				(5)
+
+
+/**
+ *   @brief  Start at the fast rate, until the concentration proves flat
+ *   @param  rate           Rate to initialize
+ *   @param  minPeriod      Period while the concentration moves, in ticks
+ *   @param  maxPeriod      Baseline period while it is flat, in ticks
+ *   @param  slopeLimit     Slope going fast, in ppm per 1000 ticks
+ *   @param  varianceLimit  Variance going fast, in ppm^2
+ **/
+void ELRATE_init(ELRATE_rate_t *rate, uint32_t minPeriod, uint32_t maxPeriod, uint32_t slopeLimit, uint32_t varianceLimit)
+{
+	memset(rate, 0, sizeof(*rate));
+
+	rate->minPeriod = minPeriod;
+	rate->maxPeriod = maxPeriod;
+	rate->slopeLimit = slopeLimit;
+	rate->varianceLimit = varianceLimit;
+	rate->calmSamples = ELRATE_CALM_SAMPLES;
+	rate->period = minPeriod;
+}
+
+
+/**
+ *   @brief  Account for a new sample and choose the period until the next one
+ *   @param  rate   Rate to update
+ *   @param  value  Concentration in ppm
+ *   @param  now    Current time in ticks
+ *   @return the period to use, in ticks
+ **/
+uint32_t ELRATE_update(ELRATE_rate_t *rate, int32_t value, uint32_t now)
+{
+	uint32_t elapsed = now - rate->lastTime;
+	uint32_t change;
+	int32_t deviation;
+	uint8_t moving;
+
+	if (!rate->primed) {
+		rate->primed = 1;
+		rate->lastValue = value;
+		rate->lastTime = now;
+		rate->mean = value * (1 << ELRATE_FRACTION_BITS);
+		return rate->period;
+	}
+
+	// Running mean and variance
+	rate->mean += (value * (1 << ELRATE_FRACTION_BITS) - rate->mean) >> ELRATE_MEAN_SHIFT;
+	deviation = value - (rate->mean >> ELRATE_FRACTION_BITS);
+	if (deviation > ELRATE_DEVIATION_MAX) {
+		deviation = ELRATE_DEVIATION_MAX;
+	}
+	if (deviation < -ELRATE_DEVIATION_MAX) {
+		deviation = -ELRATE_DEVIATION_MAX;
+	}
+	rate->variance += (int32_t)((uint32_t)(deviation * deviation) - rate->variance) >> ELRATE_MEAN_SHIFT;
+
+	// Slope, compared without dividing: |change| x 1000 > limit x elapsed
+	change = (value > rate->lastValue) ? (uint32_t)(value - rate->lastValue) : (uint32_t)(rate->lastValue - value);
+	moving = ((uint64_t)change * 1000 > (uint64_t)rate->slopeLimit * elapsed)
+			|| rate->variance > rate->varianceLimit;
+
+	rate->lastValue = value;
+	rate->lastTime = now;
+
+	if (moving) {
+		if (rate->period != rate->minPeriod) {
+			rate->triggers++;
+		}
+		rate->period = rate->minPeriod;
+		rate->calm = 0;
+	}
+	else if (++rate->calm >= rate->calmSamples) {
+		rate->calm = 0;
+		rate->period = (rate->period > rate->maxPeriod / 2) ? rate->maxPeriod : rate->period * 2;
+	}
+
+	return rate->period;
+}
@@ -0,0 +1,85 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#ifndef __ELRATE_H
+#define __ELRATE_H
+
+#include <stdint.h>
+
+
+/********************************************************************
+ * Rate parameters
+ ********************************************************************/
+
+#define ELRATE_MEAN_SHIFT				(3)		// Mean and variance averaged over about 2^3 samples
+#define ELRATE_FRACTION_BITS			(4)		// Fractional bits of the mean
+
+
+/********************************************************************
+ * Adaptive sampling rate
+ *
+ * Polls slowly while the concentration is flat and fast as soon as it
+ * moves. On each sample the slope since the previous sample and a
+ * running variance are compared with their limits:
+ *
+ *   - above either limit, the period drops at once to minPeriod
+ *   - after calmSamples samples below both, the period doubles, up to
+ *     maxPeriod
+ *
+ * A change starting right after a poll is therefore seen at most
+ * maxPeriod (plus a transaction) later, which bounds the detection
+ * latency; then the concentration is followed at minPeriod. Times are
+ * in the caller's tick unit, the slope limit in ppm per 1000 ticks
+ * (ppm/s with ms ticks).
+ ********************************************************************/
+
+typedef struct {
+	uint32_t		minPeriod;										// Period while the concentration moves
+	uint32_t		maxPeriod;										// Baseline period while it is flat
+	uint32_t		slopeLimit;										// In ppm per 1000 ticks
+	uint32_t		varianceLimit;									// In ppm^2
+	uint8_t			calmSamples;									// Calm samples before each doubling of the period
+	uint32_t		period;											// Current period
+	uint8_t			calm;											// Calm samples since the last change of period
+	uint8_t			primed;
+	int32_t			lastValue;
+	uint32_t		lastTime;
+	int32_t			mean;											// With ELRATE_FRACTION_BITS
+	uint32_t		variance;										// In ppm^2
+	uint32_t		triggers;										// Times the period dropped to minPeriod
+} ELRATE_rate_t;
+
+
+/********************************************************************
+ * Public functions
+ ********************************************************************/
+
+void ELRATE_init(ELRATE_rate_t *rate, uint32_t minPeriod, uint32_t maxPeriod, uint32_t slopeLimit, uint32_t varianceLimit);
+uint32_t ELRATE_update(ELRATE_rate_t *rate, int32_t value, uint32_t now);
+
+
+#endif /* __ELRATE_H */
@@ -0,0 +1,112 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include "elReport.h"
+
+#include <string.h>
+
+
+/**
+ *   @brief  Start reporting by exception, the first sample being always reported
+ *   @param  deadband   Deadband to initialize
+ *   @param  absolute   Smallest change of the concentration reported, in ppm, 0 to disable
+ *   @param  relative   Smallest change reported, in per mille of the last reported concentration,
+ *                      0 to disable
+ *   @param  heartbeat  Longest time without a report in ticks, 0 to disable
+ **/
+void ELREPORT_init(ELREPORT_deadband_t *deadband, uint32_t absolute, uint32_t relative, uint32_t heartbeat)
+{
+	memset(deadband, 0, sizeof(*deadband));
+
+	deadband->absolute = absolute;
+	deadband->relative = (relative > ELREPORT_RELATIVE_SCALE) ? ELREPORT_RELATIVE_SCALE : relative;
+	deadband->heartbeat = heartbeat;
+}
+
+
+/**
+ *   @brief  Decide whether a sample must be reported, and take it as the reference if so
+ *   @param  deadband  Deadband to update
+ *   @param  data      Sample read with ELCOM_getSenData()
+ *   @param  now       Current time in ticks
+ *   @return the reasons to report it (ELREPORT_VALUE, ELREPORT_STATUS, ELREPORT_HEARTBEAT),
+ *           0 if it can be dropped
+ **/
+uint8_t ELREPORT_update(ELREPORT_deadband_t *deadband, const ELICHENS_SensorData_t *data, uint32_t now)
+{
+	uint32_t delta, last, band;
+	uint8_t reasons = 0;
+
+	if (!deadband->primed) {
+		deadband->primed = 1;
+		reasons = ELREPORT_VALUE | ELREPORT_STATUS;
+	}
+	else {
+		delta = (data->value > deadband->lastValue)
+				? (uint32_t)data->value - (uint32_t)deadband->lastValue
+				: (uint32_t)deadband->lastValue - (uint32_t)data->value;
+
+		last = (deadband->lastValue < 0) ? 0U - (uint32_t)deadband->lastValue : (uint32_t)deadband->lastValue;
+		last = (last > ELREPORT_VALUE_MAX) ? ELREPORT_VALUE_MAX : last;
+		band = last * deadband->relative / ELREPORT_RELATIVE_SCALE;
+		band = (band > deadband->absolute) ? band : deadband->absolute;
+
+		if (delta > band) {
+			reasons |= ELREPORT_VALUE;
+		}
+		if (data->status != deadband->lastStatus || data->error != deadband->lastError) {
+			reasons |= ELREPORT_STATUS;
+		}
+		if (0 != deadband->heartbeat && now - deadband->lastTime >= deadband->heartbeat) {
+			reasons |= ELREPORT_HEARTBEAT;
+		}
+	}
+
+	if (0 == reasons) {
+		deadband->suppressed++;
+		return 0;
+	}
+
+	deadband->emitted++;
+	deadband->lastValue = data->value;
+	deadband->lastStatus = data->status;
+	deadband->lastError = data->error;
+	deadband->lastTime = now;
+
+	return reasons;
+}
+
+
+/**
+ *   @brief  Clear the emitted and suppressed counters
+ *   @param  deadband  Deadband whose counters are cleared
+ **/
+void ELREPORT_resetStats(ELREPORT_deadband_t *deadband)
+{
+	deadband->emitted = 0;
+	deadband->suppressed = 0;
+}
@@ -0,0 +1,88 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#ifndef __ELREPORT_H
+#define __ELREPORT_H
+
+#include <stdint.h>
+#include "ELICHENS_driver.h"
+
+
+/********************************************************************
+ * Report parameters
+ ********************************************************************/
+
+#define ELREPORT_RELATIVE_SCALE			(1000)	// Relative deadband in per mille of the last reported value
+#define ELREPORT_VALUE_MAX				(4000000UL)	// Keeps the relative deadband in 32 bits
+
+
+/********************************************************************
+ * Report by exception
+ *
+ * Decides whether a sample is worth sending, against the last one that
+ * was sent. It is when:
+ *
+ *   VALUE      the concentration moved out of the deadband, the larger
+ *              of the absolute one (ppm) and the relative one (per
+ *              mille of the last reported value), so that the absolute
+ *              one keeps the noise out near 0 ppm
+ *   STATUS     the status or error code changed
+ *   HEARTBEAT  nothing was sent for a heartbeat period, so that the
+ *              receiver knows the sensor is alive
+ *
+ * The first sample is always sent. A 0 disables the matching deadband
+ * or the heartbeat. Times are in the caller's tick unit.
+ ********************************************************************/
+
+#define ELREPORT_VALUE					(1<<0)
+#define ELREPORT_STATUS					(1<<1)
+#define ELREPORT_HEARTBEAT				(1<<2)
+
+typedef struct {
+	uint32_t		absolute;										// Deadband in ppm
+	uint32_t		relative;										// Deadband in 1/ELREPORT_RELATIVE_SCALE
+	uint32_t		heartbeat;										// Longest time without a report
+	uint8_t			primed;
+	int32_t			lastValue;										// Last reported sample
+	uint8_t			lastStatus;
+	uint8_t			lastError;
+	uint32_t		lastTime;
+	uint32_t		emitted;										// Samples reported
+	uint32_t		suppressed;										// Samples dropped in the deadband
+} ELREPORT_deadband_t;
+
+
+/********************************************************************
+ * Public functions
+ ********************************************************************/
+
+void ELREPORT_init(ELREPORT_deadband_t *deadband, uint32_t absolute, uint32_t relative, uint32_t heartbeat);
+uint8_t ELREPORT_update(ELREPORT_deadband_t *deadband, const ELICHENS_SensorData_t *data, uint32_t now);
+void ELREPORT_resetStats(ELREPORT_deadband_t *deadband);
+
+
+#endif /* __ELREPORT_H */
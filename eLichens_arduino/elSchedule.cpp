@@ -0,0 +1,166 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include "elSchedule.h"
+
+#include <string.h>
+
+#ifdef __unix__
+#include <time.h>
+#endif
+
+
+/**
+ *   @brief  Start a fixed-rate schedule, the first run being due at once
+ *   @param  schedule  Schedule to initialize
+ *   @param  period    Time between two runs, in ticks (not 0)
+ *   @param  now       Current time in ticks
+ **/
+void ELSCHED_init(ELSCHED_schedule_t *schedule, uint32_t period, uint32_t now)
+{
+	schedule->period = period;
+	schedule->deadline = now;
+	ELSCHED_resetStats(schedule);
+}
+
+
+/**
+ *   @brief  Change the period, the next run being due one new period after the previous deadline.
+ *           The statistics mix both periods until ELSCHED_resetStats().
+ *   @param  schedule  Schedule to change
+ *   @param  period    New time between two runs, in ticks (not 0)
+ **/
+void ELSCHED_setPeriod(ELSCHED_schedule_t *schedule, uint32_t period)
+{
+	schedule->deadline += period - schedule->period;
+	schedule->period = period;
+}
+
+
+/**
+ *   @brief  Tell whether a run is due, and if so account for it and move to the next deadline
+ *   @param  schedule  Schedule to check
+ *   @param  now       Current time in ticks
+ *   @return 1 if the caller must run now, 0 otherwise
+ **/
+uint8_t ELSCHED_isDue(ELSCHED_schedule_t *schedule, uint32_t now)
+{
+	uint32_t late = now - schedule->deadline;
+	uint32_t skipped;
+	uint8_t bin = 0;
+
+	if ((int32_t)late < 0) {
+		return 0;
+	}
+
+	// Lateness histogram, log2 bins
+	if (late > schedule->jitterMax) {
+		schedule->jitterMax = late;
+	}
+	while (late >> bin && bin < ELSCHED_JITTER_BINS - 1) {
+		bin++;
+	}
+	schedule->jitter[bin]++;
+
+	if (0 == schedule->runs) {
+		schedule->firstRun = now;
+	}
+	schedule->lastRun = now;
+	schedule->runs++;
+
+	// Stay on the grid of deadlines, skipping the missed ones
+	skipped = (late >= schedule->period) ? late / schedule->period : 0;
+	schedule->missed += skipped;
+	schedule->deadline += (skipped + 1) * schedule->period;
+
+	return 1;
+}
+
+
+/**
+ *   @brief  Time left before the next run, e.g. to sleep meanwhile
+ *   @param  schedule  Schedule to check
+ *   @param  now       Current time in ticks
+ *   @return the number of ticks to wait, 0 if a run is due
+ **/
+uint32_t ELSCHED_timeUntilDue(const ELSCHED_schedule_t *schedule, uint32_t now)
+{
+	int32_t left = (int32_t)(schedule->deadline - now);
+
+	return (left > 0) ? (uint32_t)left : 0;
+}
+
+
+/**
+ *   @brief  Average time between two runs since the statistics were reset
+ *   @param  schedule  Schedule to check
+ *   @param  scale     Sub-divisions of a tick in the result (e.g. 1000 for us with ms ticks)
+ *   @return the achieved period in 1/scale ticks, 0 before the second run
+ **/
+uint32_t ELSCHED_getAchievedPeriod(const ELSCHED_schedule_t *schedule, uint32_t scale)
+{
+	if (schedule->runs < 2) {
+		return 0;
+	}
+
+	uint32_t elapsed = schedule->lastRun - schedule->firstRun;
+	uint32_t intervals = schedule->runs - 1;
+
+	// Split to stay in 32 bits: elapsed x scale would overflow after an hour in ms
+	return (elapsed / intervals) * scale + (elapsed % intervals) * scale / intervals;
+}
+
+
+/**
+ *   @brief  Clear the run, missed and jitter statistics, the deadlines are kept
+ *   @param  schedule  Schedule to reset
+ **/
+void ELSCHED_resetStats(ELSCHED_schedule_t *schedule)
+{
+	schedule->firstRun = 0;
+	schedule->lastRun = 0;
+	schedule->runs = 0;
+	schedule->missed = 0;
+	schedule->jitterMax = 0;
+	memset(schedule->jitter, 0, sizeof(schedule->jitter));
+}
+
+
+#ifdef __unix__
+/**
+ *   @brief  Monotonic tick for host programs, not affected by changes of the wall clock
+ *   @return CLOCK_MONOTONIC in ms
+ **/
+uint32_t ELSCHED_getMonotonicTick(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint32_t)now.tv_sec * 1000u + (uint32_t)(now.tv_nsec / 1000000);
+}
+#endif
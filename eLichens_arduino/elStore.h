@@ -0,0 +1,144 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#ifndef __ELSTORE_H
+#define __ELSTORE_H
+
+#include <stdint.h>
+#include "ELICHENS_driver.h"
+
+
+/********************************************************************
+ * Store parameters
+ ********************************************************************/
+
+#ifndef ELSTORE_BLOCK_SAMPLES
+#define ELSTORE_BLOCK_SAMPLES			(32)	// Samples per block: keep it small on a MCU, raise it on a gateway
+#endif
+
+#ifndef ELSTORE_TEMPERATURE_STEP
+#define ELSTORE_TEMPERATURE_STEP		(10)	// Temperature quantization step in 1/100 degC
+#endif
+
+
+/********************************************************************
+ * Block format
+ *
+ * Samples are stored in blocks, one column per field. All fixed size
+ * fields are little-endian, columns use LEB128 varints and zigzag
+ * encoding for signed values:
+ *
+ *   | SIZE (2) | COUNT (2) | RUNTIME first, min, max (3 x 4) | PPM min, max (2 x 4) |
+ *   | TIME column size (2) | STATUS column size (2) | PPM column size (2) |
+ *   | TIME column | STATUS column | PPM column | TEMPERATURE column |
+ *
+ * TIME:        delta-of-delta of the run time
+ * STATUS:      runs of (length, status, error)
+ * PPM:         delta of the concentration
+ * TEMPERATURE: delta of the temperature quantized by ELSTORE_TEMPERATURE_STEP
+ *
+ * The min/max fields let a reader skip whole blocks during range queries.
+ ********************************************************************/
+
+#define ELSTORE_HEADER_SIZE				(30)
+#define ELSTORE_VARINT_MAX_SIZE			(5)
+
+
+/********************************************************************
+ * Store data structures
+ ********************************************************************/
+
+typedef struct {
+	uint16_t		count;											// Samples in the block
+	uint32_t		runtimeFirst;
+	uint32_t		runtimeMin;
+	uint32_t		runtimeMax;
+	int32_t			ppmMin;
+	int32_t			ppmMax;
+	uint32_t		runtimeLast;
+	int32_t			runtimeDelta;
+	int32_t			ppmLast;
+	int16_t			temperatureLast;
+	uint8_t			status;											// Current status run
+	uint8_t			error;
+	uint16_t		statusRun;
+	uint16_t		timeSize;
+	uint16_t		statusSize;
+	uint16_t		ppmSize;
+	uint16_t		temperatureSize;
+	uint8_t			time[ELSTORE_BLOCK_SAMPLES * ELSTORE_VARINT_MAX_SIZE];
+	uint8_t			statusColumn[ELSTORE_BLOCK_SAMPLES * (ELSTORE_VARINT_MAX_SIZE + 2)];
+	uint8_t			ppm[ELSTORE_BLOCK_SAMPLES * ELSTORE_VARINT_MAX_SIZE];
+	uint8_t			temperature[ELSTORE_BLOCK_SAMPLES * 3];
+} ELSTORE_block_t;
+
+typedef struct {
+	uint16_t		size;											// Size of the whole block, to skip to the next one
+	uint16_t		count;											// Samples in the block
+	uint32_t		runtimeMin;
+	uint32_t		runtimeMax;
+	int32_t			ppmMin;
+	int32_t			ppmMax;
+	uint16_t		index;											// Samples already read
+	const uint8_t	*time;											// Column cursors
+	const uint8_t	*status;
+	const uint8_t	*ppm;
+	const uint8_t	*temperature;
+	const uint8_t	*timeEnd;										// Column ends, never read past
+	const uint8_t	*statusEnd;
+	const uint8_t	*ppmEnd;
+	const uint8_t	*temperatureEnd;
+	uint32_t		runtimeLast;
+	int32_t			runtimeDelta;
+	int32_t			ppmLast;
+	int16_t			temperatureLast;
+	uint8_t			statusLast;
+	uint8_t			errorLast;
+	uint16_t		statusRun;
+} ELSTORE_reader_t;
+
+
+/********************************************************************
+ * Writing
+ ********************************************************************/
+
+void ELSTORE_blockInit(ELSTORE_block_t *block);
+uint8_t ELSTORE_blockAppend(ELSTORE_block_t *block, const ELICHENS_Sample_t *sample);
+uint16_t ELSTORE_blockSize(ELSTORE_block_t *block);
+uint16_t ELSTORE_blockSeal(ELSTORE_block_t *block, uint8_t *dataOut, uint16_t size);
+
+
+/********************************************************************
+ * Reading
+ ********************************************************************/
+
+uint8_t ELSTORE_readerInit(ELSTORE_reader_t *reader, const uint8_t *data, uint32_t size);
+uint8_t ELSTORE_readerNext(ELSTORE_reader_t *reader, ELICHENS_Sample_t *sample);
+uint8_t ELSTORE_readerOverlaps(ELSTORE_reader_t *reader, uint32_t runtimeFrom, uint32_t runtimeTo, int32_t ppmFrom, int32_t ppmTo);
+
+
+#endif /* __ELSTORE_H */
@@ -0,0 +1,94 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#ifndef __ELWINDOW_H
+#define __ELWINDOW_H
+
+#include <stdint.h>
+#include "ELICHENS_driver.h"
+#include "elGate.h"
+
+
+/********************************************************************
+ * Window parameters
+ ********************************************************************/
+
+#define ELWINDOW_FRACTION_BITS			(8)		// Fractional bits of the running mean
+#define ELWINDOW_VALUE_MAX				(0x3FFFFF)	// Keeps the deviations to the mean in 32 bits
+
+
+/********************************************************************
+ * Windowed aggregation
+ *
+ * Summarizes the samples of consecutive windows of a fixed length:
+ * count, min, max, mean and variance of the concentration (Welford's
+ * algorithm in fixed point), and the time spent in each ELGATE state.
+ * Each sample costs a constant time and no memory.
+ *
+ * The concentration of the samples read during warm-up, calibration
+ * or with an error code is meaningless: they only count in the time
+ * in state. A window is closed by the first sample after its end, and
+ * the windows without any sample are not reported. Times are in the
+ * caller's tick unit.
+ ********************************************************************/
+
+typedef struct {
+	uint32_t		start;											// Time of the start of the window
+	uint32_t		count;											// Samples aggregated
+	int32_t			min;											// In ppm
+	int32_t			max;
+	int32_t			mean;
+	uint32_t		variance;										// In ppm^2
+	uint32_t		stddev;											// In ppm
+	uint32_t		timeInState[ELGATE_STATE_COUNT];				// Sums up to the window length
+} ELWINDOW_summary_t;
+
+typedef struct {
+	uint32_t		length;											// Window length
+	uint32_t		start;
+	uint32_t		count;
+	int32_t			min;
+	int32_t			max;
+	int32_t			mean;											// With ELWINDOW_FRACTION_BITS
+	uint64_t		m2;												// Sum of the squared deviations, with 2 * ELWINDOW_FRACTION_BITS
+	ELGATE_state_t	state;											// State of the last sample
+	uint32_t		stateSince;
+	uint32_t		timeInState[ELGATE_STATE_COUNT];
+	uint32_t		windows;										// Windows closed
+} ELWINDOW_window_t;
+
+
+/********************************************************************
+ * Public functions
+ ********************************************************************/
+
+void ELWINDOW_init(ELWINDOW_window_t *window, uint32_t length, uint32_t now);
+uint8_t ELWINDOW_update(ELWINDOW_window_t *window, const ELICHENS_SensorData_t *data, uint32_t now,
+		ELWINDOW_summary_t *summary);
+
+
+#endif /* __ELWINDOW_H */
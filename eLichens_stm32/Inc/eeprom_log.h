@@ -0,0 +1,73 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#ifndef __EEPROM_LOG_H
+#define __EEPROM_LOG_H
+
+#include <stdint.h>
+#include "ELICHENS_driver.h"
+
+
+/********************************************************************
+ * Log parameters
+ *
+ * Samples are kept in a circular log of fixed 8-byte records in the
+ * data EEPROM (2 KB, 256 records on the L053). Every record slot is
+ * written once per lap, so wear is evenly spread: logging one sample
+ * per minute rewrites each slot every ~4 hours. From the second lap on,
+ * the flags word is also cleared before the slot is programmed.
+ *
+ * Record layout (2 words):
+ *   word 0: run time in seconds
+ *   word 1: concentration (signed 24 bits, saturated) | flags (8 bits)
+ * flags:  bits 0-5: ELCOM_STATUS_* bits, bit 6: valid, bit 7: lap parity
+ ********************************************************************/
+
+#define EELOG_RECORD_SIZE			(8)
+#define EELOG_RECORD_COUNT			((DATA_EEPROM_END - DATA_EEPROM_BASE + 1) / EELOG_RECORD_SIZE)
+#define EELOG_BATCH_SIZE			(8)		// Records buffered in RAM before being programmed at once
+
+
+typedef struct {
+	uint32_t	runtime;	// Run time in seconds
+	int32_t		value;		// Concentration value in PPM
+	uint8_t		status;		// Status code
+} EELOG_record_t;
+
+
+/********************************************************************
+ * Public functions
+ ********************************************************************/
+
+void EELOG_init(void);
+void EELOG_append(const ELICHENS_Sample_t *sample);
+void EELOG_flush(void);
+uint16_t EELOG_count(void);
+uint16_t EELOG_read(uint16_t first, EELOG_record_t *records, uint16_t count);
+
+
+#endif /* __EEPROM_LOG_H */
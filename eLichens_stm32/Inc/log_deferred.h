@@ -0,0 +1,66 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#ifndef __LOG_DEFERRED_H
+#define __LOG_DEFERRED_H
+
+#include <stdint.h>
+
+
+/********************************************************************
+ * Deferred logs
+ *
+ * Instead of being formatted on the MCU, a message is sent as the
+ * position of its format string in the .logfmt section followed by
+ * its raw arguments. tools/logdecode.py reads .logfmt from the ELF
+ * file and rebuilds the text on the host.
+ *
+ * Frame layout:
+ *   | LOGD_FRAME_SYNC (1) | ID (2) | LEN (1) | LEN bytes of arguments |
+ * Arguments are in format order: %s as a null-terminated string,
+ * %c as 1 byte, any other conversion as 4 bytes little-endian.
+ ********************************************************************/
+
+#define LOGD_FRAME_SYNC				(0xA5)
+#define LOGD_FRAME_MAX_SIZE			(64)
+#define LOGD_FRAME_HEADER_SIZE		(4)
+
+
+/**
+ * Log a message. The format must be a string literal: it is only stored
+ * in the .logfmt section, at build time.
+ */
+#define LOGD_message(format, ...) do {												\
+	static const char logd_format[] __attribute__((section(".logfmt"))) = format;	\
+	LOGD_send(logd_format, ##__VA_ARGS__);											\
+} while (0)
+
+
+void LOGD_send(const char *format, ...);
+
+
+#endif /* __LOG_DEFERRED_H */
@@ -71,6 +71,16 @@
 
 /* USER CODE BEGIN Private defines */
 
+#define LOG_DEFERRED	0	// 1: logs are sent in binary and decoded on the host by tools/logdecode.py
+#define UPLINK_BATCH	0	// 1: reported samples are sent in binary batches, decoded on the host by tools/elbatch_decode.c
+
+// Profiling zones of the application, after those of the lib (see elProfile.h, built with EL_PROFILE=1)
+#define PROFILE_ZONE_FORMAT			(ELPROFILE_ZONE_APP + 0)	// xvsprintf() of a log message
+#define PROFILE_ZONE_UART_TX		(ELPROFILE_ZONE_APP + 1)	// Frame sent to the sensor, blocking
+#define PROFILE_ZONE_UART_RX		(ELPROFILE_ZONE_APP + 2)	// Start of a reception
+#define PROFILE_ZONE_UART_ABORT		(ELPROFILE_ZONE_APP + 3)	// End of a reception
+#define PROFILE_ZONE_UART_IRQ		(ELPROFILE_ZONE_APP + 4)	// USART1 interrupt, a byte from the sensor
+
 /* USER CODE END Private defines */
 
 #ifdef __cplusplus
@@ -52,7 +52,9 @@ void HardFault_Handler(void);
 void SVC_Handler(void);
 void PendSV_Handler(void);
 void SysTick_Handler(void);
+void DMA1_Channel4_5_6_7_IRQHandler(void);
 void USART1_IRQHandler(void);
+void USART2_IRQHandler(void);
 
 #ifdef __cplusplus
 }
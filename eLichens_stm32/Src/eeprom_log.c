@@ -0,0 +1,232 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include "eeprom_log.h"
+
+#include "stm32l0xx_hal.h"
+
+
+#define EELOG_FLAG_VALID			(1 << 6)
+#define EELOG_FLAG_LAP				(1 << 7)
+#define EELOG_STATUS_MASK			(0x3F)
+#define EELOG_VALUE_MAX				(0x7FFFFF)
+#define EELOG_VALUE_MIN				(-0x800000)
+
+
+/* Private variables ---------------------------------------------------------*/
+
+static uint16_t head;						// Next slot to program
+static uint16_t used;						// Valid records in EEPROM
+static uint8_t lap;							// Lap parity flag of the records being written
+static uint32_t batch[EELOG_BATCH_SIZE][2];	// Records waiting to be programmed
+static uint8_t batchCount;
+
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint32_t EELOG_readWord(uint16_t slot, uint8_t word)
+{
+	return *(__IO uint32_t *)(DATA_EEPROM_BASE + slot * EELOG_RECORD_SIZE + word * 4);
+}
+
+
+static uint8_t EELOG_readFlags(uint16_t slot)
+{
+	return (uint8_t)(EELOG_readWord(slot, 1) >> 24);
+}
+
+
+/* Public functions ----------------------------------------------------------*/
+
+/**
+ * @brief  Locate the head of the log after a reset, from the valid and lap flags.
+ *         A slot left invalid by a reset while it was programmed is the head:
+ *         it is followed by the valid records of the previous lap.
+ */
+void EELOG_init(void)
+{
+	uint8_t first = EELOG_readFlags(0);
+	uint8_t next = EELOG_readFlags(1);
+	uint16_t slot;
+
+	batchCount = 0;
+
+	if (!(first & EELOG_FLAG_VALID)) {
+		head = 0;
+		if (next & EELOG_FLAG_VALID) {
+			// Interrupted while starting a new lap
+			used = EELOG_RECORD_COUNT - 1;
+			lap = (next & EELOG_FLAG_LAP) ^ EELOG_FLAG_LAP;
+		}
+		else {
+			// Blank EEPROM
+			used = 0;
+			lap = EELOG_FLAG_LAP;
+		}
+		return;
+	}
+
+	lap = first & EELOG_FLAG_LAP;
+
+	for (slot = 1; slot < EELOG_RECORD_COUNT; slot++) {
+		uint8_t flags = EELOG_readFlags(slot);
+
+		if (!(flags & EELOG_FLAG_VALID)) {
+			head = slot;
+			if (slot + 1 < EELOG_RECORD_COUNT && (EELOG_readFlags(slot + 1) & EELOG_FLAG_VALID)) {
+				// Interrupted while programming this slot
+				used = EELOG_RECORD_COUNT - 1;
+			}
+			else {
+				// First lap not completed yet
+				used = slot;
+			}
+			return;
+		}
+
+		if ((flags & EELOG_FLAG_LAP) != lap) {
+			// Older records of the previous lap start here
+			head = slot;
+			used = EELOG_RECORD_COUNT;
+			return;
+		}
+	}
+
+	// Lap completed: the next one toggles the flag
+	head = 0;
+	used = EELOG_RECORD_COUNT;
+	lap ^= EELOG_FLAG_LAP;
+}
+
+
+/**
+ * @brief  Add a sample to the log. It is kept in RAM until a whole batch can be programmed.
+ * @param  sample: sample to log (error code and temperature are not kept)
+ */
+void EELOG_append(const ELICHENS_Sample_t *sample)
+{
+	int32_t value = sample->data.value;
+
+	if (value > EELOG_VALUE_MAX) {
+		value = EELOG_VALUE_MAX;
+	}
+	else if (value < EELOG_VALUE_MIN) {
+		value = EELOG_VALUE_MIN;
+	}
+
+	batch[batchCount][0] = sample->runtime;
+	batch[batchCount][1] = ((uint32_t)value & 0xFFFFFF)
+			| ((uint32_t)(EELOG_FLAG_VALID | (sample->data.status & EELOG_STATUS_MASK)) << 24);
+	batchCount++;
+
+	if (EELOG_BATCH_SIZE == batchCount) {
+		EELOG_flush();
+	}
+}
+
+
+/**
+ * @brief  Program the pending records in a single unlock/lock sequence
+ */
+void EELOG_flush(void)
+{
+	uint8_t i;
+
+	if (0 == batchCount) {
+		return;
+	}
+
+	HAL_FLASHEx_DATAEEPROM_Unlock();
+
+	for (i = 0; i < batchCount; i++) {
+		uint32_t address = DATA_EEPROM_BASE + head * EELOG_RECORD_SIZE;
+
+		// The slot holds a record of the previous lap after the first one: clear its flags
+		// first, so that a reset before the new flags word is programmed leaves it invalid
+		if (EELOG_readFlags(head) & EELOG_FLAG_VALID) {
+			HAL_FLASHEx_DATAEEPROM_Program(FLASH_TYPEPROGRAMDATA_WORD, address + 4, 0);
+		}
+
+		// The flags word goes last: it marks the record as valid
+		HAL_FLASHEx_DATAEEPROM_Program(FLASH_TYPEPROGRAMDATA_WORD, address, batch[i][0]);
+		HAL_FLASHEx_DATAEEPROM_Program(FLASH_TYPEPROGRAMDATA_WORD, address + 4, batch[i][1] | ((uint32_t)lap << 24));
+
+		if (used < EELOG_RECORD_COUNT) {
+			used++;
+		}
+
+		if (++head == EELOG_RECORD_COUNT) {
+			head = 0;
+			lap ^= EELOG_FLAG_LAP;
+		}
+	}
+
+	HAL_FLASHEx_DATAEEPROM_Lock();
+
+	batchCount = 0;
+}
+
+
+/**
+ * @brief  Number of records stored in EEPROM (pending records are not counted until flushed)
+ */
+uint16_t EELOG_count(void)
+{
+	return used;
+}
+
+
+/**
+ * @brief  Bulk read of the stored records, oldest first
+ * @param  first: index of the first record to read, 0 being the oldest one
+ * @param  records: destination
+ * @param  count: maximum number of records to read
+ * @retval number of records read
+ */
+uint16_t EELOG_read(uint16_t first, EELOG_record_t *records, uint16_t count)
+{
+	uint16_t oldest = (head + EELOG_RECORD_COUNT - used) % EELOG_RECORD_COUNT;
+	uint16_t i;
+
+	if (first >= used) {
+		return 0;
+	}
+	if (count > used - first) {
+		count = used - first;
+	}
+
+	for (i = 0; i < count; i++) {
+		uint16_t slot = (oldest + first + i) % EELOG_RECORD_COUNT;
+		uint32_t word = EELOG_readWord(slot, 1);
+
+		records[i].runtime = EELOG_readWord(slot, 0);
+		records[i].value = (int32_t)(word << 8) >> 8; // Sign extend 24 bits
+		records[i].status = (uint8_t)(word >> 24) & EELOG_STATUS_MASK;
+	}
+
+	return count;
+}
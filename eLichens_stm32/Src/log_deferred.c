@@ -0,0 +1,116 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include "log_deferred.h"
+
+#include <stdarg.h>
+#include "uart_log.h"
+
+
+extern const char __logfmt_start[];		// Defined by the linker script
+
+
+/**
+ * @brief  Encode a message and queue it to the log UART.
+ *         Arguments that do not fit in LOGD_FRAME_MAX_SIZE are truncated.
+ * @param  format: format string, stored in the .logfmt section
+ * @param  ...: arguments of the format
+ */
+void LOGD_send(const char *format, ...)
+{
+	uint8_t frame[LOGD_FRAME_MAX_SIZE];
+	uint8_t size = LOGD_FRAME_HEADER_SIZE;
+	uint16_t id = (uint16_t)(format - __logfmt_start);
+	va_list args;
+	char c;
+
+	va_start(args, format);
+
+	// Only walk the conversions to know the arguments types, nothing is formatted
+	while (0 != (c = *format++)) {
+		if ('%' != c) {
+			continue;
+		}
+
+		// Flags, width and size prefix
+		do {
+			c = *format++;
+		} while (c == '0' || c == '-' || c == '.' || (c >= '1' && c <= '9') || c == 'l' || c == 'L');
+
+		if (0 == c) {
+			break;
+		}
+
+		switch (c | 0x20) // Lower case
+		{
+		case 's': {
+			const char *str = va_arg(args, const char*);
+			while (size < LOGD_FRAME_MAX_SIZE - 1 && *str) {
+				frame[size++] = *str++;
+			}
+			if (size < LOGD_FRAME_MAX_SIZE) {
+				frame[size++] = 0;
+			}
+			break;
+		}
+
+		case 'c':
+			if (size < LOGD_FRAME_MAX_SIZE) {
+				frame[size++] = (uint8_t)va_arg(args, int);
+			}
+			break;
+
+		case 'b':
+		case 'o':
+		case 'd':
+		case 'u':
+		case 'x': {
+			uint32_t value = va_arg(args, uint32_t);
+			if (size + 4 <= LOGD_FRAME_MAX_SIZE) {
+				frame[size++] = (uint8_t)value;
+				frame[size++] = (uint8_t)(value >> 8);
+				frame[size++] = (uint8_t)(value >> 16);
+				frame[size++] = (uint8_t)(value >> 24);
+			}
+			break;
+		}
+
+		default:
+			// Not a conversion (e.g. "%%")
+			break;
+		}
+	}
+
+	va_end(args);
+
+	frame[0] = LOGD_FRAME_SYNC;
+	frame[1] = (uint8_t)id;
+	frame[2] = (uint8_t)(id >> 8);
+	frame[3] = size - LOGD_FRAME_HEADER_SIZE;
+
+	ULOG_write(frame, size);
+}
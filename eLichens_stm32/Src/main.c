@@ -45,22 +45,91 @@
 #include <string.h>
 #include "xprintf.h"
 #include "ELICHENS_driver.h"
+#include "elSchedule.h"
+#include "elFilter.h"
+#include "elGate.h"
+#include "elRate.h"
+#include "elAlarm.h"
+#include "elChange.h"
+#include "elReport.h"
+#include "elWindow.h"
+#include "elBatch.h"
+#include "elProfile.h"
+#include "eeprom_log.h"
+#include "uart_log.h"
+#include "log_deferred.h"
 
 /* USER CODE END Includes */
 
 /* Private variables ---------------------------------------------------------*/
 UART_HandleTypeDef huart1;
 UART_HandleTypeDef huart2;
+DMA_HandleTypeDef hdma_usart2_tx;
 
 /* USER CODE BEGIN PV */
 
 /* Private variables ---------------------------------------------------------*/
 
+#define EEPROM_LOG_PERIOD_S		60	// Keep one sample per minute in the EEPROM log
+#define SAMPLE_PERIOD_MS		1000	// Time between two samples while the concentration moves
+#define SAMPLE_PERIOD_MAX_MS	8000	// Time between two samples while it is flat
+#define RATE_SLOPE_LIMIT		20		// Slope polling fast, in ppm/s
+#define RATE_VARIANCE_LIMIT		100		// Variance polling fast, in ppm^2
+#define ALARM_HIGH_PPM			1000
+#define ALARM_HIGH_HIGH_PPM		5000
+#define ALARM_HYSTERESIS_PPM	100
+#define ALARM_RISE_PPM_S		50
+#define ALARM_CONFIRM_MS		1000	// Time between the samples confirming an alarm: the sensor refresh
+#define CHANGE_ALLOWANCE_PPM	10		// Half the smallest sustained shift to detect
+#define CHANGE_CUSUM_PPM		200
+#define CHANGE_EWMA_PPM			15
+#define REPORT_DEADBAND_PPM		20		// Report a sample when it moved by more than 20 ppm,
+#define REPORT_DEADBAND_PERMILLE	50		// or 5 % at high concentrations,
+#define REPORT_HEARTBEAT_MS		60000	// or after a minute without report
+#define WINDOW_LENGTH_MS		60000	// One summary of the samples a minute
+#define BATCH_MAX_SAMPLES		32		// Samples per uplink frame at most,
+#define BATCH_MAX_AGE_MS		300000	// and 5 minutes of delay at most
+#define SCHEDULE_STATS_PERIOD	60	// Samples between two reports of the sampling statistics
+
+ELSCHED_schedule_t sampleSchedule;
+
+// Transactions with the sensor, outcomes and latencies
+ELMETRICS_metrics_t sensorMetrics;
+
+// Smoothed concentration: median of 3 against spikes, then EMA with alpha = 1/4
+ELFILTER_stage_t ppmStages[2];
+ELFILTER_chain_t ppmFilter = { ppmStages, 2 };
+
+// Skip warm-up and calibration samples, and poll slower meanwhile
+ELGATE_gate_t statusGate;
+
+// Poll slowly while the concentration is flat
+ELRATE_rate_t sampleRate;
+
+// Leak alarms, confirmed by the next measurements of the sensor
+ELALARM_alarm_t ppmAlarm;
+
+// Early warning of small leaks, well below the alarm thresholds
+ELCHANGE_detector_t ppmChange;
+uint8_t ppmChangeFlags = 0;
+
+// Report by exception to save the link
+ELREPORT_deadband_t ppmReport;
+
+// Summary of the samples of each window
+ELWINDOW_window_t sampleWindow;
+
+#if UPLINK_BATCH
+// Reported samples, sent in compressed binary frames rather than text lines
+ELBATCH_batch_t uplinkBatch;
+#endif
+
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
+static void MX_DMA_Init(void);
 static void MX_USART2_UART_Init(void);
 static void MX_USART1_UART_Init(void);
 
@@ -72,6 +141,7 @@ ELCOM_errorCode_t el_uartTransmit(uint8_t *data, uint16_t size);
 ELCOM_errorCode_t el_uartReceive(uint8_t *data);
 ELCOM_errorCode_t el_uartWaitUntilReceived(void);
 void el_uartAbortReceive(void);
+void el_alarmCallback(ELALARM_alarm_t *alarm, uint8_t flag, uint8_t raised, int32_t value);
 
 // Define our sensor
 ELICHENS_Sensor_t sensor = {
@@ -79,6 +149,8 @@ ELICHENS_Sensor_t sensor = {
   .uartReceive = &el_uartReceive,
   .uartWaitUntilReceived = &el_uartWaitUntilReceived,
   .uartAbortReceive = &el_uartAbortReceive,
+  .getTick = &HAL_GetTick,
+  .metrics = &sensorMetrics,
 };
 
 /* USER CODE END PFP */
@@ -87,23 +159,35 @@ ELICHENS_Sensor_t sensor = {
 
 // Utility function for logs
 
-static char log_buffer[320];
+#if LOG_DEFERRED
+
+#define log_message LOGD_message
+
+#else
 
 void log_message(char *message, ...)
 {
+	char log_buffer[320];	// On the stack: messages of interrupts and of the main loop may interleave
 	va_list args;
+	uint16_t length;
 
 	// Construct log message from format string and optional arguments
 	va_start(args, message);
+	EL_PROFILE_BEGIN(PROFILE_ZONE_FORMAT);
 	xvsprintf(log_buffer, message, args);
+	EL_PROFILE_END(PROFILE_ZONE_FORMAT);
 	va_end(args);
 
 	// Add LF-CR at end of string
-	strcat(log_buffer, "\n");
+	length = strlen(log_buffer);
+	log_buffer[length++] = '\n';
 
-	HAL_UART_Transmit(&huart2, (uint8_t*)log_buffer, strlen(log_buffer), 100);
+	// Queued for the USART2 DMA: never blocks, dropped if the ring is full
+	ULOG_write((uint8_t*)log_buffer, length);
 }
 
+#endif
+
 // Implement our UART communication
 
 static ELCOM_errorCode_t el_errorCodeFromHAL(HAL_StatusTypeDef res)
@@ -123,7 +207,9 @@ ELCOM_errorCode_t el_uartTransmit(uint8_t *data, uint16_t size)
 {
 	HAL_StatusTypeDef res;
 
+	EL_PROFILE_BEGIN(PROFILE_ZONE_UART_TX);
 	res = HAL_UART_Transmit(&huart1, data, size, 10 * size);
+	EL_PROFILE_END(PROFILE_ZONE_UART_TX);
 
 	if (HAL_OK != res) {
 		log_message("Failed to transmit data, res=%d", res);
@@ -138,8 +224,10 @@ ELCOM_errorCode_t el_uartWaitUntilReceived(void)
 	uint32_t start = HAL_GetTick();
 
 	while (HAL_GetTick() - start < 250) {
-		if (ELCOM_isResponseComplete(sensor.bufferRx)) {
-			// Yet we need to abort
+		sensor.rxLength = ELCOM_DATA_BUFFER_SIZE - huart1.RxXferCount;
+
+		if (ELCOM_RESPONSE_INCOMPLETE != ELCOM_getResponseState(sensor.bufferRx, sensor.rxLength)) {
+			// Complete, or invalid and left to ELCOM_parseReceivedPacket() to report. Yet we need to abort
 			el_uartAbortReceive();
 			return ELCOM_NO_ERROR;
 		}
@@ -155,11 +243,10 @@ ELCOM_errorCode_t el_uartReceive(uint8_t *data)
 {
 	HAL_StatusTypeDef res;
 
-	// Clear the buffer
-	memset(data, 0, ELCOM_DATA_BUFFER_SIZE);
-
 	// Start listening to incoming message
+	EL_PROFILE_BEGIN(PROFILE_ZONE_UART_RX);
 	res = HAL_UART_Receive_IT(&huart1, data, ELCOM_DATA_BUFFER_SIZE);
+	EL_PROFILE_END(PROFILE_ZONE_UART_RX);
 
 	if (HAL_OK != res) {
 		log_message("Failed to receive data, res=%d", res);
@@ -171,8 +258,73 @@ ELCOM_errorCode_t el_uartReceive(uint8_t *data)
 
 void el_uartAbortReceive(void)
 {
+	EL_PROFILE_BEGIN(PROFILE_ZONE_UART_ABORT);
 	HAL_UART_Abort_IT(&huart1);
+	EL_PROFILE_END(PROFILE_ZONE_UART_ABORT);
+}
+
+
+void el_alarmCallback(ELALARM_alarm_t *alarm, uint8_t flag, uint8_t raised, int32_t value)
+{
+	log_message("ALARM %s %s at %d ppm",
+			(ELALARM_HIGH_HIGH == flag) ? "high-high" : (ELALARM_HIGH == flag) ? "high" : "rate-of-rise",
+			raised ? "raised" : "cleared", value);
+
+#if UPLINK_BATCH
+	// Do not keep the samples leading to an alarm waiting
+	if (raised) {
+		ELBATCH_flush(&uplinkBatch, ELBATCH_FLAG_ALARM);
+	}
+#endif
+}
+
+
+#if UPLINK_BATCH
+void el_uplinkSend(const uint8_t *frame, uint16_t size)
+{
+	ULOG_write(frame, size);
+}
+#endif
+
+
+#if EL_PROFILE
+static const char * const el_profileZoneNames[ELPROFILE_ZONE_COUNT] = {
+	"prepare", "crc", "parse", "format", "uart tx", "uart rx", "uart abort", "uart irq",
+};
+
+
+// HAL_TIM is not enabled: TIM21 is programmed through its registers
+static void el_profileInit(void)
+{
+	// Free-running at the core clock, one tick per cycle, over the full 16-bit range
+	RCC->APB2ENR |= RCC_APB2ENR_TIM21EN;
+	TIM21->PSC = 0;
+	TIM21->ARR = 0xFFFF;
+	TIM21->EGR = TIM_EGR_UG;
+	TIM21->CR1 = TIM_CR1_CEN;
+
+	ELPROFILE_init((const volatile uint16_t *)&TIM21->CNT);
+}
+
+
+// Log the cycles spent in each zone since the last dump
+static void el_profileDump(void)
+{
+	ELPROFILE_zone_t zone;
+	uint8_t i;
+
+	log_message("profile: %d Hz core clock ; %d cycles of markers taken out", SystemCoreClock, ELPROFILE_overhead);
+	for (i = 0; i < ELPROFILE_ZONE_COUNT; i++) {
+		// Copied first: the dump itself runs through the format zone
+		zone = ELPROFILE_zones[i];
+		if (zone.count) {
+			log_message("profile %s: n = %d ; min/avg/max = %d/%d/%d cycles",
+					el_profileZoneNames[i], zone.count, zone.min, zone.total / zone.count, zone.max);
+		}
+	}
+	ELPROFILE_reset();
 }
+#endif
 
 
 /* USER CODE END 0 */
@@ -188,9 +340,19 @@ int main(void)
 
   ELCOM_errorCode_t error_code;
   char str[24];
-  uint32_t sn, runtime;
-  ELICHENS_SensorData_t data;
-  float temperature;
+  uint32_t sn;
+  ELICHENS_Sample_t sample;
+  uint32_t last_logged = 0;
+  ELGATE_state_t state;
+  ELGATE_action_t action;
+  uint32_t period;
+  uint8_t flags;
+  int32_t filtered;
+  ELWINDOW_summary_t summary;
+  ELMETRICS_counters_t metrics;
+#if EL_PROFILE
+  GPIO_PinState b1, b1Last = GPIO_PIN_SET;
+#endif
 
   /* USER CODE END 1 */
 
@@ -212,12 +374,23 @@ int main(void)
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_USART2_UART_Init();
   MX_USART1_UART_Init();
   /* USER CODE BEGIN 2 */
 
+  ULOG_init(&huart2);
+
+#if EL_PROFILE
+  el_profileInit();
+#endif
+
   log_message("Starting up...");
 
+  // Find where the EEPROM log stopped
+  EELOG_init();
+  log_message("EEPROM log: %d records", EELOG_count());
+
   // Init sensor
   HAL_Delay(EL_STARTUP_DELAY_MS);
 
@@ -246,6 +419,22 @@ int main(void)
   ELCOM_getSenDataFmt(&sensor, &sensor.dataFormat);
   HAL_Delay(10);
 
+  // Sample on absolute deadlines, whatever the time spent in the transactions
+  ELSCHED_init(&sampleSchedule, SAMPLE_PERIOD_MS, HAL_GetTick());
+
+  ELFILTER_initMedian(&ppmStages[0], 3);
+  ELFILTER_initEma(&ppmStages[1], 2);
+
+  ELGATE_init(&statusGate, SAMPLE_PERIOD_MS, HAL_GetTick());
+  ELRATE_init(&sampleRate, SAMPLE_PERIOD_MS, SAMPLE_PERIOD_MAX_MS, RATE_SLOPE_LIMIT, RATE_VARIANCE_LIMIT);
+  ELALARM_init(&ppmAlarm, ALARM_HIGH_PPM, ALARM_HIGH_HIGH_PPM, ALARM_HYSTERESIS_PPM, ALARM_RISE_PPM_S, &el_alarmCallback);
+  ELCHANGE_init(&ppmChange, CHANGE_ALLOWANCE_PPM, CHANGE_CUSUM_PPM, CHANGE_EWMA_PPM);
+  ELREPORT_init(&ppmReport, REPORT_DEADBAND_PPM, REPORT_DEADBAND_PERMILLE, REPORT_HEARTBEAT_MS);
+  ELWINDOW_init(&sampleWindow, WINDOW_LENGTH_MS, HAL_GetTick());
+#if UPLINK_BATCH
+  ELBATCH_init(&uplinkBatch, BATCH_MAX_SAMPLES, BATCH_MAX_AGE_MS, 1, &el_uplinkSend);
+#endif
+
   /* USER CODE END 2 */
 
   /* Infinite loop */
@@ -253,19 +442,121 @@ int main(void)
   while (1)
   {
 
-	error_code = ELCOM_getSysRunTime(&sensor, &runtime);
-	error_code |= ELCOM_getSenData(&sensor, &data);
-	error_code |= ELCOM_getSenTemp(&sensor, &temperature);
+#if EL_PROFILE
+	// Dump the profile on demand, when the user button is pressed
+	b1 = HAL_GPIO_ReadPin(B1_GPIO_Port, B1_Pin);
+	if (GPIO_PIN_RESET == b1 && GPIO_PIN_SET == b1Last) {
+	  el_profileDump();
+	}
+	b1Last = b1;
+#endif
+
+	if (!ELSCHED_isDue(&sampleSchedule, HAL_GetTick())) {
+	  __WFI(); // Sleep until the next SysTick
+	  continue;
+	}
+
+	error_code = ELCOM_getSample(&sensor, &sample);
 
 	if (ELCOM_NO_ERROR == error_code) {
-	  log_message("time = %d ; ppm = %d ; milliDegC = %d",
-	      runtime, data.value, (uint32_t)(temperature * 1000));
+	  state = statusGate.state;
+	  action = ELGATE_update(&statusGate, &sample.data, HAL_GetTick());
+
+	  if (state != statusGate.state) {
+	    log_message("Sensor state %d -> %d, %d s spent in state %d so far", state, statusGate.state,
+	        ELGATE_getTimeInState(&statusGate, state, HAL_GetTick()) / 1000, state);
+	  }
+
+	  if (ELWINDOW_update(&sampleWindow, &sample.data, HAL_GetTick(), &summary)) {
+	    log_message("window: %d samples ; min/mean/max = %d/%d/%d ppm ; stddev = %d ppm",
+	        summary.count, summary.min, summary.mean, summary.max, summary.stddev);
+	    log_message("window: ms ready/warm-up/calibration/lamp/unreliable = %d/%d/%d/%d/%d",
+	        summary.timeInState[ELGATE_STATE_READY], summary.timeInState[ELGATE_STATE_WARMUP],
+	        summary.timeInState[ELGATE_STATE_CALIBRATION], summary.timeInState[ELGATE_STATE_LAMP],
+	        summary.timeInState[ELGATE_STATE_UNRELIABLE]);
+	  }
+
+	  // Adaptive rate while the data is reliable, the gate's period otherwise
+	  period = (ELGATE_STATE_READY == statusGate.state)
+	      ? ELRATE_update(&sampleRate, sample.data.value, HAL_GetTick()) : ELGATE_getPeriod(&statusGate);
+
+	  if (ELGATE_SUPPRESS != action) {
+	    filtered = ELFILTER_update(&ppmFilter, sample.data.value);
+
+	    // Only what changed, and a heartbeat
+	    if (ELREPORT_update(&ppmReport, &sample.data, HAL_GetTick())) {
+#if UPLINK_BATCH
+	      ELBATCH_add(&uplinkBatch, &sample, HAL_GetTick());
+#else
+	      log_message("time = %d ; ppm = %d ; filtered = %d ; degC = %.2d%s",
+	          sample.runtime, sample.data.value, filtered, sample.temperature,
+	          (ELGATE_FLAG == action) ? " ; unreliable" : "");
+#endif
+	    }
+
+	    // Confirm a crossing at the next refresh of the sensor rather than at the next period:
+	    // reading it again before would only repeat the same measurement
+	    if (ELALARM_CONFIRM == ELALARM_update(&ppmAlarm, sample.data.value, HAL_GetTick())) {
+	      period = ALARM_CONFIRM_MS;
+	    }
+	  }
+
+	  if (period != sampleSchedule.period) {
+	    ELSCHED_setPeriod(&sampleSchedule, period);
+	  }
+
+	  // The baseline of the change detector must not learn from unreliable samples
+	  if (ELGATE_ACCEPT == action) {
+	    flags = ELCHANGE_update(&ppmChange, sample.data.value);
+	    if (flags != ppmChangeFlags) {
+	      log_message("Change %s at %d ppm, baseline = %d ppm", flags ? "detected" : "over",
+	          sample.data.value, ppmChange.baseline >> ELCHANGE_FRACTION_BITS);
+	      ppmChangeFlags = flags;
+	    }
+	  }
+
+	  // Only reliable samples are worth the EEPROM
+	  if (ELGATE_ACCEPT == action
+	      && (0 == last_logged || sample.runtime - last_logged >= EEPROM_LOG_PERIOD_S)) {
+	    EELOG_append(&sample);
+	    last_logged = sample.runtime;
+	  }
 	}
 	else {
 	  log_message("Failed to read sensor value");
 	}
 
-    HAL_Delay(1000);
+#if UPLINK_BATCH
+	// Reports may stop for a while: do not hold the last ones back
+	ELBATCH_poll(&uplinkBatch, HAL_GetTick());
+#endif
+
+	if (SCHEDULE_STATS_PERIOD == sampleSchedule.runs) {
+	  log_message("period = %.3d ms ; missed = %d ; late max = %d ms",
+	      ELSCHED_getAchievedPeriod(&sampleSchedule, 1000), sampleSchedule.missed, sampleSchedule.jitterMax);
+	  log_message("late histogram = %d %d %d %d %d %d %d %d",
+	      sampleSchedule.jitter[0], sampleSchedule.jitter[1], sampleSchedule.jitter[2], sampleSchedule.jitter[3],
+	      sampleSchedule.jitter[4], sampleSchedule.jitter[5], sampleSchedule.jitter[6], sampleSchedule.jitter[7]);
+	  log_message("reports: emitted = %d ; suppressed = %d", ppmReport.emitted, ppmReport.suppressed);
+	  ELMETRICS_snapshot(&sensorMetrics, &metrics);
+	  log_message("sensor: data/temp = %d/%d ; retries = %d ; bytes tx/rx = %d/%d",
+	      metrics.transactions[ELMETRICS_getCommandSlot(ELCOM_CMD_GET_SEN_DATA)],
+	      metrics.transactions[ELMETRICS_getCommandSlot(ELCOM_CMD_GET_SEN_TEMP)],
+	      metrics.retries, metrics.bytesTx, metrics.bytesRx);
+	  log_message("sensor outcomes = %d %d %d %d %d %d %d %d %d %d",
+	      metrics.outcomes[0], metrics.outcomes[1], metrics.outcomes[2], metrics.outcomes[3], metrics.outcomes[4],
+	      metrics.outcomes[5], metrics.outcomes[6], metrics.outcomes[7], metrics.outcomes[8], metrics.outcomes[9]);
+	  log_message("sensor latency histogram = %d %d %d %d %d %d %d %d ; max = %d ms",
+	      metrics.latency[0], metrics.latency[1], metrics.latency[2], metrics.latency[3],
+	      metrics.latency[4], metrics.latency[5], metrics.latency[6], metrics.latency[7], metrics.latencyMax);
+#if UPLINK_BATCH
+	  log_message("uplink: frames = %d ; samples = %d ; bytes raw/sent = %d/%d",
+	      uplinkBatch.frames, uplinkBatch.samples, uplinkBatch.bytesRaw, uplinkBatch.bytesSent);
+#endif
+	  ELSCHED_resetStats(&sampleSchedule);
+	  ELREPORT_resetStats(&ppmReport);
+	  ELMETRICS_reset(&sensorMetrics);
+	}
 
   /* USER CODE END WHILE */
 
@@ -379,6 +670,21 @@ static void MX_USART2_UART_Init(void)
 
 }
 
+/** 
+  * Enable DMA controller clock
+  */
+static void MX_DMA_Init(void) 
+{
+  /* DMA controller clock enable */
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  /* DMA interrupt init */
+  /* DMA1_Channel4_5_6_7_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel4_5_6_7_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel4_5_6_7_IRQn);
+
+}
+
 /** Configure pins as 
         * Analog 
         * Input 
@@ -416,6 +722,12 @@ static void MX_GPIO_Init(void)
 
 /* USER CODE BEGIN 4 */
 
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+	// Send the next queued log messages
+	ULOG_txComplete(huart);
+}
+
 /* USER CODE END 4 */
 
 /**
@@ -0,0 +1,165 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include "uart_log.h"
+
+#include <string.h>
+
+
+/* Private variables ---------------------------------------------------------*/
+
+static UART_HandleTypeDef *uart;
+static uint8_t buffer[ULOG_BUFFER_SIZE];
+static uint16_t head;				// Next byte to reserve
+static volatile uint16_t committed;	// End of the bytes ready to be sent
+static volatile uint16_t tail;		// Start of the bytes not sent yet
+static uint8_t writers;				// Producers copying their data
+static uint16_t sending;			// Size of the DMA transfer in progress, 0 if idle
+static uint32_t dropped;			// Messages lost because the ring was full
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief  Send the next contiguous chunk of committed bytes, if the DMA is idle.
+ *         Must be called with interrupts disabled.
+ */
+static void ULOG_kick(void)
+{
+	uint16_t end;
+
+	if (0 != sending || committed == tail) {
+		return;
+	}
+
+	end = (committed > tail) ? committed : ULOG_BUFFER_SIZE;
+	sending = end - tail;
+
+	if (HAL_OK != HAL_UART_Transmit_DMA(uart, &buffer[tail], sending)) {
+		sending = 0;
+	}
+}
+
+
+/* Public functions ----------------------------------------------------------*/
+
+/**
+ * @brief  Drain the log ring through the DMA of the given UART
+ */
+void ULOG_init(UART_HandleTypeDef *huart)
+{
+	uart = huart;
+	head = 0;
+	committed = 0;
+	tail = 0;
+	writers = 0;
+	sending = 0;
+	dropped = 0;
+}
+
+
+/**
+ * @brief  Queue a message without blocking. Safe to call from interrupts.
+ *         Space is reserved with interrupts masked, the copy itself runs with
+ *         interrupts enabled; the bytes are sent once no producer is copying anymore.
+ * @param  data: message to send
+ * @param  size: message size in bytes
+ * @retval 1 if queued, 0 if dropped because the ring is full
+ */
+uint8_t ULOG_write(const uint8_t *data, uint16_t size)
+{
+	uint32_t primask = __get_PRIMASK();
+	uint16_t start, free, first;
+
+	__disable_irq();
+
+	// One byte is kept free to tell a full ring from an empty one
+	free = (tail + ULOG_BUFFER_SIZE - head - 1) % ULOG_BUFFER_SIZE;
+	if (size > free) {
+		dropped++;
+		__set_PRIMASK(primask);
+		return 0;
+	}
+
+	start = head;
+	head = (head + size) % ULOG_BUFFER_SIZE;
+	writers++;
+
+	__set_PRIMASK(primask);
+
+	first = ULOG_BUFFER_SIZE - start;
+	if (size <= first) {
+		memcpy(&buffer[start], data, size);
+	}
+	else {
+		memcpy(&buffer[start], data, first);
+		memcpy(buffer, &data[first], size - first);
+	}
+
+	__disable_irq();
+
+	// The last producer out publishes all reserved bytes
+	if (0 == --writers) {
+		committed = head;
+		ULOG_kick();
+	}
+
+	__set_PRIMASK(primask);
+
+	return 1;
+}
+
+
+/**
+ * @brief  To be called from HAL_UART_TxCpltCallback()
+ */
+void ULOG_txComplete(UART_HandleTypeDef *huart)
+{
+	uint32_t primask;
+
+	if (huart != uart) {
+		return;
+	}
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+
+	tail = (tail + sending) % ULOG_BUFFER_SIZE;
+	sending = 0;
+	ULOG_kick();
+
+	__set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief  Number of messages dropped since ULOG_init()
+ */
+uint32_t ULOG_getDropped(void)
+{
+	return dropped;
+}
@@ -79,6 +79,36 @@ void xfputs ( void ( *func )( unsigned char ), const char*str )
 }
 
 
+/**********************************************************************//**
+ * @brief Divide by 10 with shifts and adds only
+ *  The Cortex-M0+ has no hardware divider: '/' and '%' would call the
+ *  software division of libgcc for every digit.
+ * @param v Dividend
+ * @param rem Pointer to the remainder
+ * @return v / 10
+ *************************************************************************/
+static uint32_t xdivu10 ( uint32_t v, char *rem )
+{
+    uint32_t q, r;
+
+
+    q  = ( v >> 1 ) + ( v >> 2 );                       /* q ~= v * 0.8 */
+    q += q >> 4;
+    q += q >> 8;
+    q += q >> 16;
+    q >>= 3;                                            /* q ~= v / 10, may be 1 too low */
+    r  = v - ( ( q << 3 ) + ( q << 1 ) );               /* r = v - q * 10 */
+
+    if ( r > 9 )
+    {
+        q++; r -= 10;
+    }
+
+    *rem = (char)r;
+    return q;
+}
+
+
 /**********************************************************************//**
  * @brief Formatted string output
  *  xprintf("%d", 1234);			"1234"
@@ -92,13 +122,14 @@ void xfputs ( void ( *func )( unsigned char ), const char*str )
  *  xprintf("%-4s", "abc");			"abc "
  *  xprintf("%4s", "abc");			" abc"
  *  xprintf("%c", 'a');				"a"
+ *  xprintf("%.3d", -23450);		"-23.450" (fixed point)
  *  xprintf("%f", 10.0);            <xprintf lacks floating point support>
  * @param fmt Pointer to the format string
  * @param arp Pointer to arguments
  *************************************************************************/
 static void xvprintf ( const char*fmt, va_list arp )
 {
-    unsigned int  r, i, j, w, f;
+    unsigned int  r, i, j, w, f, pr, n, sh;
     unsigned long v;
     char          s[ 16 ], c, d, *p;
 
@@ -136,6 +167,16 @@ static void xvprintf ( const char*fmt, va_list arp )
             w = w * 10 + c - '0';
         }
 
+        pr = 0;
+
+        if ( c == '.' )                                 /* Precision: decimals of a fixed point numeral */
+        {
+            for ( c = *fmt++; c >= '0' && c <= '9'; c = *fmt++ )
+            {
+                pr = pr * 10 + c - '0';
+            }
+        }
+
         if ( ( c == 'l' ) || ( c == 'L' ) )     /* Prefix: Size is long int */
         {
             f |= 4; c = *fmt++;
@@ -176,14 +217,14 @@ static void xvprintf ( const char*fmt, va_list arp )
             case 'C':                                           /* Character */
                 xputc( (char)va_arg( arp, int ) ); continue;
             case 'B':                                           /* Binary */
-                r = 2; break;
+                r = 2; sh = 1; break;
             case 'O':                                           /* Octal */
-                r = 8; break;
+                r = 8; sh = 3; break;
             case 'D':                                           /* Signed decimal */
             case 'U':                                           /* Unsigned decimal */
-                r = 10; break;
+                r = 10; sh = 0; break;
             case 'X':                                           /* Hexdecimal */
-                r = 16; break;
+                r = 16; sh = 4; break;
             default:                                            /* Unknown type (passthrough) */
                 xputc( c ); continue;
         }
@@ -197,17 +238,26 @@ static void xvprintf ( const char*fmt, va_list arp )
             f |= 8;
         }
 
-        i = 0;
+        i = 0; n = 0;
 
         do
         {
-            d = (char)( v % r ); v /= r;
+            if ( r == 10 )
+            {
+                v = xdivu10( (uint32_t)v, &d );
+            }
+            else
+            {
+                d = (char)( v & ( r - 1 ) ); v >>= sh;         /* Power of 2 radix */
+            }
 
             if ( d > 9 ) { d += ( c == 'x' ) ? 0x27 : 0x07; }
 
             s[ i++ ] = d + '0';
+
+            if ( ++n == pr && i < sizeof( s ) ) { s[ i++ ] = '.'; }
         }
-        while ( v && i < sizeof( s ) );
+        while ( ( v || n <= pr ) && i < sizeof( s ) );
 
         if ( f & 8 ) { s[ i++ ] = '-'; }
 
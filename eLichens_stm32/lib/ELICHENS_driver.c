@@ -26,6 +26,7 @@
   ******************************************************************************
   */
 #include "ELICHENS_driver.h"
+#include "elProfile.h"
 
 #include <string.h>
 
@@ -51,6 +52,40 @@
 )
 
 
+/**
+ * Smallest data of the responses read at fixed positions. The parser does not
+ * clear the packet: a shorter response would leave the bytes of an older one.
+ */
+#define EL_RUN_TIME_LENGTH				(4)		// Run time
+#define EL_SEN_DATA_LENGTH				(7)		// Sensor index, status, error, value
+#define EL_SEN_TEMP_LENGTH				(5)		// Sensor index, temperature
+#define EL_SEN_DATA_FMT_LENGTH			(5)		// Sensor index, decimal point, unit, resolution
+
+
+/**
+ * Monotonic time in ms, 0 when the platform does not provide any.
+ */
+static uint32_t EL_getTick(ELICHENS_Sensor_t *sensor)
+{
+	return (NULL != sensor->getTick) ? sensor->getTick() : 0;
+}
+
+
+/**
+ * Account for a transaction in the optional metrics, returns its error code.
+ */
+static ELCOM_errorCode_t EL_endTransaction(ELICHENS_Sensor_t *sensor, ELMETRICS_transaction_t *transaction,
+		ELCOM_errorCode_t err_code)
+{
+	if (NULL != sensor->metrics) {
+		transaction->outcome = err_code;
+		ELMETRICS_record(sensor->metrics, transaction);
+	}
+
+	return err_code;
+}
+
+
 /**
  * Generic function to send an ELCOM packet to the sensor, process its response and
  * handle any error that could occur.
@@ -59,33 +94,64 @@ static ELCOM_errorCode_t EL_sendAndReceivePacket(ELICHENS_Sensor_t *sensor)
 {
 	ELCOM_errorCode_t err_code;
 	uint8_t size;
+	uint16_t rxLength;
+	uint32_t sent = 0;
+	ELMETRICS_transaction_t transaction = { sensor->packet.cmd, ELCOM_NO_ERROR, 0, 0, 0, 0 };
 
+	EL_PROFILE_BEGIN(ELPROFILE_ZONE_PREPARE);
 	size = ELCOM_prepareSendPacket(&sensor->packet, sensor->bufferTx);
+	EL_PROFILE_END(ELPROFILE_ZONE_PREPARE);
 
 	// Start listening
+	sensor->rxLength = 0;
 	err_code = sensor->uartReceive(sensor->bufferRx);
 	if (ELCOM_NO_ERROR != err_code) {
-		return err_code;
+		return EL_endTransaction(sensor, &transaction, err_code);
 	}
 
 	// Send the packet
 	err_code = sensor->uartTransmit(sensor->bufferTx, size);
 	if (ELCOM_NO_ERROR != err_code) {
 		sensor->uartAbortReceive();
-		return err_code;
+		return EL_endTransaction(sensor, &transaction, err_code);
+	}
+	transaction.bytesTx = size;
+
+	if (NULL != sensor->capture || NULL != sensor->metrics) {
+		sent = EL_getTick(sensor);
+	}
+
+	if (NULL != sensor->capture) {
+		ELCAP_record(sensor->capture, ELCAP_RECORD_TX, sent, sensor->bufferTx, size);
 	}
 
 	// Wait for response
 	err_code = sensor->uartWaitUntilReceived();
+	rxLength = (sensor->rxLength > ELCOM_DATA_BUFFER_SIZE) ? ELCOM_DATA_BUFFER_SIZE : sensor->rxLength;
+	transaction.bytesRx = rxLength;
 	if (ELCOM_NO_ERROR != err_code) {
 		sensor->uartAbortReceive();
-		return err_code;
+		if (NULL != sensor->capture) {
+			ELCAP_record(sensor->capture, ELCAP_RECORD_RX_TIMEOUT, EL_getTick(sensor), sensor->bufferRx, rxLength);
+		}
+		return EL_endTransaction(sensor, &transaction, err_code);
+	}
+
+	if (NULL != sensor->metrics) {
+		transaction.complete = 1;
+		transaction.latency = EL_getTick(sensor) - sent;
+	}
+
+	if (NULL != sensor->capture) {
+		ELCAP_record(sensor->capture, ELCAP_RECORD_RX, EL_getTick(sensor), sensor->bufferRx, rxLength);
 	}
 
 	// Parse response
+	EL_PROFILE_BEGIN(ELPROFILE_ZONE_PARSE);
 	err_code = ELCOM_parseReceivedPacket(sensor->bufferRx, &sensor->packet);
+	EL_PROFILE_END(ELPROFILE_ZONE_PARSE);
 
-	return err_code;
+	return EL_endTransaction(sensor, &transaction, err_code);
 }
 
 
@@ -204,6 +270,10 @@ ELCOM_errorCode_t ELCOM_getSysRunTime(ELICHENS_Sensor_t *sensor, uint32_t *runti
 		return err_code;
 	}
 
+	if (sensor->packet.dataLength < EL_RUN_TIME_LENGTH) {
+		return ELCOM_INVALID_LEN;
+	}
+
 	memcpy(runtime, &sensor->packet.data[0], 4);
 
 	return err_code; // OK
@@ -225,6 +295,10 @@ ELCOM_errorCode_t ELCOM_getSenData(ELICHENS_Sensor_t *sensor, ELICHENS_SensorDat
 
 	err_code = EL_sendAndReceivePacket(sensor);
 
+	if (ELCOM_NO_ERROR == err_code && sensor->packet.dataLength < EL_SEN_DATA_LENGTH) {
+		err_code = ELCOM_INVALID_LEN;
+	}
+
 	if (ELCOM_NO_ERROR != err_code) {
 		data->status = 0xFF;
 		data->error = 0xFF;
@@ -243,10 +317,12 @@ ELCOM_errorCode_t ELCOM_getSenData(ELICHENS_Sensor_t *sensor, ELICHENS_SensorDat
 }
 
 
-ELCOM_errorCode_t ELCOM_getSenTemp(ELICHENS_Sensor_t *sensor, float *temperature)
+/**
+ * Internal temperature as sent by the sensor, in 1/100 degC.
+ */
+static ELCOM_errorCode_t EL_getSenTempRaw(ELICHENS_Sensor_t *sensor, int32_t *temperature)
 {
 	ELCOM_errorCode_t err_code;
-	int32_t tmp;
 
 	sensor->packet.cmd = ELCOM_CMD_GET_SEN_TEMP;
 	sensor->packet.dataLength = 1;
@@ -258,8 +334,28 @@ ELCOM_errorCode_t ELCOM_getSenTemp(ELICHENS_Sensor_t *sensor, float *temperature
 		return err_code;
 	}
 
+	if (sensor->packet.dataLength < EL_SEN_TEMP_LENGTH) {
+		return ELCOM_INVALID_LEN;
+	}
+
 	// byte 0 is the sensor index
-	memcpy(&tmp, &sensor->packet.data[1], 4);
+	memcpy(temperature, &sensor->packet.data[1], 4);
+
+	return err_code;
+}
+
+
+ELCOM_errorCode_t ELCOM_getSenTemp(ELICHENS_Sensor_t *sensor, float *temperature)
+{
+	ELCOM_errorCode_t err_code;
+	int32_t tmp;
+
+	err_code = EL_getSenTempRaw(sensor, &tmp);
+
+	if (ELCOM_NO_ERROR != err_code) {
+		return err_code;
+	}
+
 	*temperature = tmp / 100.;
 
 	return err_code;
@@ -280,6 +376,10 @@ ELCOM_errorCode_t ELCOM_getSenDataFmt(ELICHENS_Sensor_t *sensor, ELCOM_DataForma
 		return err_code;
 	}
 
+	if (sensor->packet.dataLength < EL_SEN_DATA_FMT_LENGTH) {
+		return ELCOM_INVALID_LEN;
+	}
+
 	// byte 0 is the sensor index
 	format->decimalPoint = sensor->packet.data[1];
 	format->unitCode = sensor->packet.data[2];
@@ -311,3 +411,32 @@ ELCOM_errorCode_t ELCOM_getSenName(ELICHENS_Sensor_t *sensor, char name[8])
 
 	return err_code;
 }
+
+
+/********************************************************************
+ * Samples
+ ********************************************************************/
+
+ELCOM_errorCode_t ELCOM_getSample(ELICHENS_Sensor_t *sensor, ELICHENS_Sample_t *sample)
+{
+	ELCOM_errorCode_t err_code;
+	int32_t tmp = 0;
+
+	sample->runtime = 0;
+	sample->temperature = 0;
+
+	err_code = ELCOM_getSenData(sensor, &sample->data);
+	if (ELCOM_NO_ERROR != err_code) {
+		return err_code;
+	}
+
+	err_code = ELCOM_getSysRunTime(sensor, &sample->runtime);
+	if (ELCOM_NO_ERROR != err_code) {
+		return err_code;
+	}
+
+	err_code = EL_getSenTempRaw(sensor, &tmp);
+	sample->temperature = (int16_t)tmp;
+
+	return err_code;
+}
@@ -30,6 +30,8 @@
 
 #include <stdint.h>
 #include "elCom.h"
+#include "elCapture.h"
+#include "elMetrics.h"
 
 
 #define EL_STARTUP_DELAY_MS				5000	// Time before we can send commands to the sensor
@@ -44,10 +46,14 @@ typedef struct {
 	ELCOM_packet_t 		packet;											// Static packet to send and receive data with the sensor
 	uint8_t 			bufferTx[ELCOM_DATA_BUFFER_SIZE];               // Transmit buffer
 	uint8_t 			bufferRx[ELCOM_DATA_BUFFER_SIZE];				// Receive buffer
+	volatile uint16_t	rxLength;										// Bytes received in bufferRx, kept up to date by the transport
 	ELCOM_errorCode_t 	(*uartTransmit)(uint8_t *data, uint16_t size);  // Callback to send some data to the sensor's UART
 	ELCOM_errorCode_t 	(*uartReceive)(uint8_t *data);					// Callback to start listening to the sensor's UART
 	ELCOM_errorCode_t   (*uartWaitUntilReceived)(void);                 // Callback to block the code until a response is received
 	void				(*uartAbortReceive)(void);                      // Callback to stop listening to the sensor's UART
+	uint32_t			(*getTick)(void);								// Optional callback returning a monotonic time in ms
+	ELCAP_capture_t		*capture;										// Optional capture of the UART traffic (NULL to disable)
+	ELMETRICS_metrics_t	*metrics;										// Optional transaction metrics (NULL to disable)
 } ELICHENS_Sensor_t;
 
 
@@ -78,4 +84,17 @@ ELCOM_errorCode_t ELCOM_getSenDataFmt(ELICHENS_Sensor_t *sensor, ELCOM_DataForma
 ELCOM_errorCode_t ELCOM_getSenName(ELICHENS_Sensor_t *sensor, char name[8]);						// Sensor name (CO2, CH4, CH4NB)
 
 
+/********************************************************************
+ * Samples
+ ********************************************************************/
+
+typedef struct {
+	uint32_t				runtime;		// Run time in seconds
+	ELICHENS_SensorData_t	data;			// Measure
+	int16_t					temperature;	// Internal temperature in 1/100 degC
+} ELICHENS_Sample_t;
+
+ELCOM_errorCode_t ELCOM_getSample(ELICHENS_Sensor_t *sensor, ELICHENS_Sample_t *sample);			// Run time, measure and temperature
+
+
 #endif // __ELICHENS_DRIVER_H__
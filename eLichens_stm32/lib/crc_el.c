@@ -26,9 +26,12 @@
   ******************************************************************************
   */
 #include "crc_el.h"
+#include "elProfile.h"
 
 
-const uint16_t crc16Table[CRC_TABLE_SIZE] = {
+// Tables generated and checked by tools/crc_gen.py
+#if (CRC_IMPLEMENTATION == CRC_IMPL_TABLE)
+const uint16_t crc16Table[CRC_TABLE_SIZE] CRC_TABLE_ATTR = {
 	0x0000, 0x8005, 0x800F, 0x000A,
 	0x801B, 0x001E, 0x0014, 0x8011,
 	0x8033, 0x0036, 0x003C, 0x8039,
@@ -94,6 +97,16 @@ const uint16_t crc16Table[CRC_TABLE_SIZE] = {
 	0x8213, 0x0216, 0x021C, 0x8219,
 	0x0208, 0x820D, 0x8207, 0x0202,
 };
+#endif
+
+#if (CRC_IMPLEMENTATION == CRC_IMPL_NIBBLE)
+const uint16_t crc16NibbleTable[CRC_NIBBLE_TABLE_SIZE] CRC_TABLE_ATTR = {
+	0x0000, 0x8005, 0x800F, 0x000A,
+	0x801B, 0x001E, 0x0014, 0x8011,
+	0x8033, 0x0036, 0x003C, 0x8039,
+	0x0028, 0x802D, 0x8027, 0x0022,
+};
+#endif
 
 
 /**
@@ -105,10 +118,12 @@ const uint16_t crc16Table[CRC_TABLE_SIZE] = {
 uint16_t CRC_computeCRC(uint8_t *pbuffer, uint32_t length)
 {
     uint16_t running_crc = CRC16_INIT_REM;
+    EL_PROFILE_BEGIN(ELPROFILE_ZONE_CRC);
 
     while (length--) {
-    	running_crc = crc16Table[((running_crc >> 8) ^ *pbuffer++)] ^ (running_crc << 8);
+    	running_crc = CRC_updateCRC(running_crc, *pbuffer++);
     }
 
+    EL_PROFILE_END(ELPROFILE_ZONE_CRC);
     return (running_crc ^ CRC16_FINAL_XOR);
 }
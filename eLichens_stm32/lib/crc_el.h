@@ -39,6 +39,38 @@
 #define CRC16_INIT_REM 			0x0000
 #define CRC16_FINAL_XOR 		0x0000
 #define CRC_TABLE_SIZE 			256
+#define CRC_NIBBLE_TABLE_SIZE 	16
+
+
+/********************************************************************
+ * Implementation, select one by defining CRC_IMPLEMENTATION
+ ********************************************************************/
+
+#define CRC_IMPL_TABLE 			0   // 256 entries table (512 bytes), fastest
+#define CRC_IMPL_NIBBLE 		1   // 16 entries table (32 bytes)
+#define CRC_IMPL_BITWISE 		2   // No table, slowest
+
+#ifndef CRC_IMPLEMENTATION
+#define CRC_IMPLEMENTATION 		CRC_IMPL_TABLE
+#endif
+
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+
+// Keep the tables in flash: AVR would otherwise copy them to SRAM at startup
+#define CRC_TABLE_ATTR          PROGMEM
+#define CRC_readTable(table, index)    pgm_read_word(&(table)[(index)])
+#else
+#define CRC_TABLE_ATTR
+#define CRC_readTable(table, index)    ((table)[(index)])
+#endif
+
+#if (CRC_IMPLEMENTATION == CRC_IMPL_TABLE)
+extern const uint16_t crc16Table[CRC_TABLE_SIZE] CRC_TABLE_ATTR;
+#elif (CRC_IMPLEMENTATION == CRC_IMPL_NIBBLE)
+extern const uint16_t crc16NibbleTable[CRC_NIBBLE_TABLE_SIZE] CRC_TABLE_ATTR;
+#endif
 
 
 /********************************************************************
@@ -48,4 +80,31 @@
 uint16_t CRC_computeCRC(uint8_t *pbuffer, uint32_t length);
 
 
+/**
+ *   @brief  Feed one more byte to a running CRC, for callers that compute the CRC
+ *           while doing something else with the bytes (start from CRC16_INIT_REM
+ *           and XOR the result with CRC16_FINAL_XOR, like CRC_computeCRC())
+ *   @param  running_crc :   the CRC of the previous bytes
+ *   @param  byte        :   the next byte
+ *   @return the updated running CRC
+ **/
+static inline uint16_t CRC_updateCRC(uint16_t running_crc, uint8_t byte)
+{
+#if (CRC_IMPLEMENTATION == CRC_IMPL_TABLE)
+	return CRC_readTable(crc16Table, (running_crc >> 8) ^ byte) ^ (uint16_t)(running_crc << 8);
+#elif (CRC_IMPLEMENTATION == CRC_IMPL_NIBBLE)
+	running_crc = CRC_readTable(crc16NibbleTable, (running_crc >> 12) ^ (byte >> 4)) ^ (uint16_t)(running_crc << 4);
+	return CRC_readTable(crc16NibbleTable, (running_crc >> 12) ^ (byte & 0x0F)) ^ (uint16_t)(running_crc << 4);
+#else
+	uint8_t bit;
+
+	running_crc ^= (uint16_t)byte << 8;
+	for (bit = 0; bit < 8; bit++) {
+		running_crc = (running_crc & 0x8000) ? (running_crc << 1) ^ CRC16_POLY : running_crc << 1;
+	}
+	return running_crc;
+#endif
+}
+
+
 #endif /* __CRC_H */
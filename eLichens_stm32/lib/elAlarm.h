@@ -0,0 +1,98 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#ifndef __ELALARM_H
+#define __ELALARM_H
+
+#include <stdint.h>
+
+
+/********************************************************************
+ * Alarm parameters
+ ********************************************************************/
+
+#define ELALARM_CONFIRM_SAMPLES			(3)		// Consecutive samples confirming an alarm, by default
+#define ELALARM_RISE_INTERVAL			(1000)	// Ticks between the references of the rate-of-rise (sensor refresh)
+
+
+/********************************************************************
+ * Alarms
+ *
+ * Each sensor has its own ELALARM_alarm_t, fed with every decoded
+ * concentration. Three alarms are checked in constant time:
+ *
+ *   ELALARM_HIGH:      value >= high, cleared below high - hysteresis
+ *   ELALARM_HIGH_HIGH: value >= highHigh, cleared below highHigh - hysteresis
+ *   ELALARM_RISE:      rise >= riseLimit ppm per 1000 ticks, cleared once
+ *                      the concentration stops rising
+ *
+ * An alarm is raised after confirmSamples consecutive samples meet its
+ * condition. Until then ELALARM_update() returns ELALARM_CONFIRM: the
+ * caller should sample again at the next refresh of the sensor rather
+ * than wait for its next period. Samples read between two refreshes
+ * repeat the same measurement and must not confirm anything.
+ * Raising and clearing call the callback, with the alarm structure so
+ * that a gateway can tell its sensors apart. A threshold set to 0
+ * disables its alarm.
+ ********************************************************************/
+
+#define ELALARM_HIGH					(1<<0)
+#define ELALARM_HIGH_HIGH				(1<<1)
+#define ELALARM_RISE					(1<<2)
+
+#define ELALARM_CONFIRM					(1)		// Returned by ELALARM_update(): sample again at the next sensor refresh
+
+typedef struct ELALARM_alarm_s ELALARM_alarm_t;
+
+typedef void (*ELALARM_callback_t)(ELALARM_alarm_t *alarm, uint8_t flag, uint8_t raised, int32_t value);
+
+struct ELALARM_alarm_s {
+	int32_t				high;										// Thresholds in ppm
+	int32_t				highHigh;
+	int32_t				hysteresis;
+	uint32_t			riseLimit;									// In ppm per 1000 ticks
+	uint8_t				confirmSamples;
+	ELALARM_callback_t	callback;									// Optional (NULL)
+	uint8_t				active;										// Raised alarms
+	uint8_t				confirming;									// Consecutive samples meeting a pending condition
+	uint8_t				primed;
+	int32_t				riseValue;									// Reference of the rate-of-rise
+	uint32_t			riseTime;
+	uint8_t				rising;										// Last verdict of the rate-of-rise
+};
+
+
+/********************************************************************
+ * Public functions
+ ********************************************************************/
+
+void ELALARM_init(ELALARM_alarm_t *alarm, int32_t high, int32_t highHigh, int32_t hysteresis, uint32_t riseLimit,
+		ELALARM_callback_t callback);
+uint8_t ELALARM_update(ELALARM_alarm_t *alarm, int32_t value, uint32_t now);
+
+
+#endif /* __ELALARM_H */
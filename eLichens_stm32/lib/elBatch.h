@@ -0,0 +1,119 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#ifndef __ELBATCH_H
+#define __ELBATCH_H
+
+#include <stdint.h>
+#include "ELICHENS_driver.h"
+#include "elStore.h"
+
+
+/********************************************************************
+ * Batch parameters
+ ********************************************************************/
+
+#ifndef ELBATCH_PAYLOAD_MAX_SIZE
+#define ELBATCH_PAYLOAD_MAX_SIZE		(240)	// Largest block in a frame, at most 256 for the LZ offsets
+#endif
+
+#ifndef ELBATCH_COMPRESSION
+#define ELBATCH_COMPRESSION				(1)		// 0 saves ELBATCH_PAYLOAD_MAX_SIZE bytes of RAM and the LZ code
+#endif
+
+#define ELBATCH_LZ_HASH_BITS			(6)		// 2^6 bytes of match table on the stack
+
+
+/********************************************************************
+ * Frame format
+ *
+ * Samples are batched in an elStore block (delta-of-delta run time,
+ * runs of status and error codes, varint deltas of the concentration
+ * and the temperature), optionally compressed, and framed as:
+ *
+ *   | ELBATCH_FRAME_SYNC (1) | FLAGS (1) | LEN (2) | LEN bytes of payload | CRC (2) |
+ *
+ * LEN and CRC are little-endian, the CRC is CRC_computeCRC() of the
+ * bytes before it. FLAGS tells whether the payload is compressed and
+ * why the batch was sent. The compressed payload is a list of tokens:
+ *
+ *   0x00 - 0x7F  literals: (token + 1) bytes follow
+ *   0x80 - 0xFF  match: (token - 0x80 + 3) bytes copied from
+ *                (next byte + 1) bytes back
+ *
+ * A batch is sent when it is full (samples or bytes), when its first
+ * sample is older than the age limit, or on request, e.g. on alarm.
+ ********************************************************************/
+
+#define ELBATCH_FRAME_SYNC				(0xB5)
+#define ELBATCH_FRAME_HEADER_SIZE		(4)
+#define ELBATCH_FRAME_CRC_SIZE			(2)
+#define ELBATCH_FRAME_MAX_SIZE			(ELBATCH_FRAME_HEADER_SIZE + ELBATCH_PAYLOAD_MAX_SIZE + ELBATCH_FRAME_CRC_SIZE)
+#define ELBATCH_SAMPLE_MAX_SIZE			(20)	// Worst growth of a block for one sample
+
+#define ELBATCH_FLAG_LZ					(1<<0)	// Compressed payload
+#define ELBATCH_FLAG_SIZE				(1<<1)	// Sent because full
+#define ELBATCH_FLAG_AGE				(1<<2)	// Sent because too old
+#define ELBATCH_FLAG_ALARM				(1<<3)	// Sent at once on alarm
+#define ELBATCH_FLAG_REQUEST			(1<<4)	// Sent on any other request
+
+#if ELBATCH_PAYLOAD_MAX_SIZE > 256
+#error "ELBATCH_PAYLOAD_MAX_SIZE must fit the 1 byte LZ offsets"
+#endif
+
+typedef struct {
+	ELSTORE_block_t	block;											// Samples of the batch
+	uint8_t			frame[ELBATCH_FRAME_MAX_SIZE];
+#if ELBATCH_COMPRESSION
+	uint8_t			packed[ELBATCH_PAYLOAD_MAX_SIZE];
+#endif
+	uint8_t			maxSamples;										// At most ELSTORE_BLOCK_SAMPLES
+	uint32_t		maxAge;											// In ticks
+	uint8_t			compress;
+	uint32_t		firstTime;										// Time of the first sample of the batch
+	void			(*send)(const uint8_t *frame, uint16_t size);	// Must consume or copy the frame
+	uint32_t		frames;											// Frames sent
+	uint32_t		samples;										// Samples sent
+	uint32_t		bytesRaw;										// Sum of the uncompressed payloads
+	uint32_t		bytesSent;										// Sum of the frames
+} ELBATCH_batch_t;
+
+
+/********************************************************************
+ * Public functions
+ ********************************************************************/
+
+void ELBATCH_init(ELBATCH_batch_t *batch, uint8_t maxSamples, uint32_t maxAge, uint8_t compress,
+		void (*send)(const uint8_t *frame, uint16_t size));
+uint8_t ELBATCH_add(ELBATCH_batch_t *batch, const ELICHENS_Sample_t *sample, uint32_t now);
+uint8_t ELBATCH_poll(ELBATCH_batch_t *batch, uint32_t now);
+uint8_t ELBATCH_flush(ELBATCH_batch_t *batch, uint8_t reason);
+
+uint16_t ELBATCH_decodeFrame(const uint8_t *frame, uint16_t size, uint8_t *blockOut, uint16_t blockSize, uint8_t *flags);
+
+
+#endif /* __ELBATCH_H */
@@ -0,0 +1,104 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#ifndef __ELCAPTURE_H
+#define __ELCAPTURE_H
+
+#include <stdint.h>
+#include "elCom.h"
+
+
+/********************************************************************
+ * Capture record format
+ *
+ * A capture is an append-only sequence of records, all little-endian:
+ *
+ *   | TYPE (1) | LEN (1) | TIMESTAMP in ms (4) | LEN bytes |
+ *
+ * TX records hold a whole frame sent to the sensor, RX records hold
+ * the bytes received for it. RX_TIMEOUT records hold the bytes received
+ * before the response timed out, if any.
+ ********************************************************************/
+
+#define ELCAP_RECORD_TX                  (0x01)
+#define ELCAP_RECORD_RX                  (0x02)
+#define ELCAP_RECORD_RX_TIMEOUT          (0x03)
+
+#define ELCAP_RECORD_HEADER_SIZE         (6)
+#define ELCAP_RECORD_MAX_SIZE            (ELCAP_RECORD_HEADER_SIZE + ELCOM_DATA_BUFFER_SIZE)
+
+
+/********************************************************************
+ * Capture definition
+ ********************************************************************/
+
+typedef struct {
+	uint8_t			*buffer;									// RAM ring storage, used when write is NULL
+	uint16_t		size;										// Size of the RAM ring
+	uint16_t		head;										// Next write position in the ring
+	uint16_t		tail;										// Oldest record in the ring
+	uint16_t		used;										// Bytes currently stored in the ring
+	uint32_t		overwritten;								// Records dropped from the ring to make room
+	void			(*write)(const uint8_t *data, uint16_t size);	// Optional sink, e.g. append to a file on host
+} ELCAP_capture_t;
+
+typedef struct {
+	uint8_t			type;		// ELCAP_RECORD_TX, ELCAP_RECORD_RX or ELCAP_RECORD_RX_TIMEOUT
+	uint8_t			length;		// Number of bytes in data
+	uint32_t		timestamp;	// Monotonic time in ms
+	const uint8_t	*data;		// Frame bytes (points into the capture)
+} ELCAP_record_t;
+
+
+/********************************************************************
+ * Capture
+ ********************************************************************/
+
+void ELCAP_initRing(ELCAP_capture_t *capture, uint8_t *buffer, uint16_t size);
+void ELCAP_record(ELCAP_capture_t *capture, uint8_t type, uint32_t timestamp, const uint8_t *data, uint8_t length);
+uint16_t ELCAP_readRing(ELCAP_capture_t *capture, uint8_t *dataOut, uint16_t size);
+uint8_t ELCAP_nextRecord(const uint8_t *data, uint32_t size, uint32_t *offset, ELCAP_record_t *record);
+
+
+/********************************************************************
+ * Replay
+ *
+ * These functions have the signature of the ELICHENS_Sensor_t
+ * callbacks so that a capture can be fed back through the driver
+ * and its decoders, without any sensor attached.
+ ********************************************************************/
+
+void ELCAP_replayBegin(const uint8_t *data, uint32_t size, volatile uint16_t *rxLength);
+uint8_t ELCAP_replayNextCommand(void);
+ELCOM_errorCode_t ELCAP_replayTransmit(uint8_t *data, uint16_t size);
+ELCOM_errorCode_t ELCAP_replayReceive(uint8_t *data);
+ELCOM_errorCode_t ELCAP_replayWaitUntilReceived(void);
+void ELCAP_replayAbortReceive(void);
+uint32_t ELCAP_replayGetTick(void);
+
+
+#endif /* __ELCAPTURE_H */
@@ -0,0 +1,162 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include "elChange.h"
+
+#include <string.h>
+
+
+#define ELCHANGE_ONE					((int32_t)1 << ELCHANGE_FRACTION_BITS)
+#define ELCHANGE_VALUE_MAX				(0x3FFFFFF >> ELCHANGE_FRACTION_BITS)	// Keeps the sums in 32 bits
+#define ELCHANGE_CUSUM_MAX				(0x3FFFFFF)
+
+
+/**
+ * One sample of one stream, without branches so that ELCHANGE_updateBatch() vectorizes.
+ * Returns the new flags from the previous ones.
+ */
+static inline uint8_t ELCHANGE_step(const ELCHANGE_config_t *config, int32_t *baseline, int32_t *cusum, int32_t *ewma,
+		uint8_t flags, int32_t value)
+{
+	int32_t x, s, e, b;
+
+	value = (value > ELCHANGE_VALUE_MAX) ? ELCHANGE_VALUE_MAX : value;
+	value = (value < -ELCHANGE_VALUE_MAX) ? -ELCHANGE_VALUE_MAX : value;
+	x = value * ELCHANGE_ONE;
+
+	s = *cusum + x - *baseline - config->allowance;
+	s = (s > 0) ? s : 0;
+	s = (s < ELCHANGE_CUSUM_MAX) ? s : ELCHANGE_CUSUM_MAX;
+
+	e = *ewma + ((x - *ewma + ((int32_t)1 << (config->ewmaShift - 1))) >> config->ewmaShift);
+
+	// Freeze the baseline once a change builds up
+	b = *baseline + ((s <= (config->cusumLimit >> 1))
+			? (x - *baseline + ((int32_t)1 << (config->baselineShift - 1))) >> config->baselineShift : 0);
+
+	*cusum = s;
+	*ewma = e;
+	*baseline = b;
+
+	// Raised above the limits, cleared once back to the baseline (CUSUM) or half the limit (EWMA)
+	return (uint8_t)(((s > config->cusumLimit || ((flags & ELCHANGE_CUSUM) && s > 0)) ? ELCHANGE_CUSUM : 0)
+			| ((e - b > config->ewmaLimit || ((flags & ELCHANGE_EWMA) && e - b > (config->ewmaLimit >> 1)))
+					? ELCHANGE_EWMA : 0));
+}
+
+
+/**
+ *   @brief  Configuration shared by the streams of a batch
+ *   @param  config      Configuration to initialize
+ *   @param  allowance   CUSUM slack in ppm, about half the smallest shift to detect
+ *   @param  cusumLimit  CUSUM decision interval in ppm (sum of the excesses)
+ *   @param  ewmaLimit   EWMA distance to the baseline in ppm
+ **/
+void ELCHANGE_initConfig(ELCHANGE_config_t *config, uint32_t allowance, uint32_t cusumLimit, uint32_t ewmaLimit)
+{
+	config->allowance = (int32_t)allowance * ELCHANGE_ONE;
+	config->cusumLimit = (int32_t)cusumLimit * ELCHANGE_ONE;
+	config->ewmaLimit = (int32_t)ewmaLimit * ELCHANGE_ONE;
+	config->ewmaShift = ELCHANGE_EWMA_SHIFT;
+	config->baselineShift = ELCHANGE_BASELINE_SHIFT;
+}
+
+
+/**
+ *   @brief  Start a detector on a single stream, the first value becoming the baseline
+ *   @param  detector    Detector to initialize
+ *   @param  allowance   See ELCHANGE_initConfig()
+ *   @param  cusumLimit  See ELCHANGE_initConfig()
+ *   @param  ewmaLimit   See ELCHANGE_initConfig()
+ **/
+void ELCHANGE_init(ELCHANGE_detector_t *detector, uint32_t allowance, uint32_t cusumLimit, uint32_t ewmaLimit)
+{
+	memset(detector, 0, sizeof(*detector));
+	ELCHANGE_initConfig(&detector->config, allowance, cusumLimit, ewmaLimit);
+}
+
+
+/**
+ *   @brief  Feed a concentration to a detector
+ *   @param  detector  Detector to update
+ *   @param  value     Concentration in ppm
+ *   @return ELCHANGE_CUSUM and/or ELCHANGE_EWMA while a change is detected, 0 otherwise
+ **/
+uint8_t ELCHANGE_update(ELCHANGE_detector_t *detector, int32_t value)
+{
+	if (!detector->primed) {
+		detector->primed = 1;
+		detector->baseline = value * ELCHANGE_ONE;
+		detector->ewma = detector->baseline;
+		detector->cusum = 0;
+		detector->flags = 0;
+	}
+
+	detector->flags = ELCHANGE_step(&detector->config, &detector->baseline, &detector->cusum, &detector->ewma,
+			detector->flags, value);
+
+	return detector->flags;
+}
+
+
+/**
+ *   @brief  Start all the streams of a batch, their first values becoming their baselines
+ *   @param  batch   Batch to start, with its configuration and arrays set
+ *   @param  values  First concentration of each stream, in ppm
+ **/
+void ELCHANGE_startBatch(ELCHANGE_batch_t *batch, const int32_t *values)
+{
+	uint32_t i;
+
+	for (i = 0; i < batch->count; i++) {
+		batch->baseline[i] = values[i] * ELCHANGE_ONE;
+		batch->ewma[i] = batch->baseline[i];
+		batch->cusum[i] = 0;
+		batch->flags[i] = 0;
+	}
+}
+
+
+/**
+ *   @brief  Feed one concentration to each stream of a batch
+ *   @param  batch   Batch to update
+ *   @param  values  Concentration of each stream, in ppm
+ **/
+void ELCHANGE_updateBatch(ELCHANGE_batch_t *batch, const int32_t *values)
+{
+	const ELCHANGE_config_t config = *batch->config;
+	int32_t *baseline = batch->baseline;
+	int32_t *cusum = batch->cusum;
+	int32_t *ewma = batch->ewma;
+	uint8_t *flags = batch->flags;
+	uint32_t count = batch->count;
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		flags[i] = ELCHANGE_step(&config, &baseline[i], &cusum[i], &ewma[i], flags[i], values[i]);
+	}
+}
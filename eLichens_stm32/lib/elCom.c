@@ -14,7 +14,7 @@
  * ========================================
 */
 
-#include "elcom.h"
+#include "elCom.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -28,32 +28,37 @@
 
 static ELCOM_errorCode_t ELCOM_validateHeader(uint8_t *packetData);
 static ELCOM_errorCode_t ELCOM_validateEOP(uint8_t *packetData);
-static ELCOM_errorCode_t ELCOM_validateCheksum(uint8_t *packetData);
-static uint8_t ELCOM_extractDataLength(uint8_t *packetData);
-static uint8_t ELCOM_extractCommand(uint8_t *packetData);
-static void ELCOM_extractData(uint8_t *packetData, uint8_t *dataOut, uint8_t dataLength);
 
 /* End private callback function -------------------------------------------*/
 
 
 /**
- *   @brief  Check if a received packet is valid and parse the fields into a structure
+ *   @brief  Check if a received packet is valid and parse the fields into a structure.
+ *           The frame is read once: header and EOP are checked first, then the CRC
+ *           is computed while the data is copied. On ELCOM_INVALID_CRC, packetOut->data
+ *           holds the rejected data; only the bytes up to dataLength are ever written.
  *   @param  dataBufferIn    The buffer containing the packet to parse
  *   @param  packetOut       Structure pointer parse data destination
- *   @return ELCOM_INVALID_CHECKSUM : if checksum invalid
- *           ELCOM_INVALID_SOP :  if start of packet is invalid
+ *   @return ELCOM_INVALID_SOP :  if start of packet is invalid
  *           ELCOM_INVALID_VER :  if invalid version field
+ *           ELCOM_INVALID_LEN :  if the length does not fit the buffer
  *           ELCOM_INVALID_EOP :  if invalid end of packet
- *           ELCOM_INVALID_CHECKSUM : if invalid checksum
+ *           ELCOM_INVALID_CRC :  if invalid checksum
+ *           ELCOM_SLAVE_ERROR :  if the packet is an error sent by the slave
  *           ELCOM_NO_ERROR otherwise
  **/
 ELCOM_errorCode_t ELCOM_parseReceivedPacket(uint8_t *dataBufferIn, ELCOM_packet_t *packetOut)
 {
 	ELCOM_errorCode_t err_code;
+	uint8_t dataLength = dataBufferIn[ELCOM_FIELD_LEN_POS];
+	uint8_t *dataIn = dataBufferIn;
+	uint8_t *dataOut = packetOut->data;
+	uint16_t running_crc = CRC16_INIT_REM;
+	uint16_t packetCrc;
+	uint8_t i;
 
 	packetOut->cmd = 0;
 	packetOut->dataLength = 0;
-	memset(packetOut->data, 0, ELCOM_FIELD_DATA_MAX_SIZE);
 
 	/* Verify the header */
 	err_code = ELCOM_validateHeader(dataBufferIn);
@@ -61,26 +66,35 @@ ELCOM_errorCode_t ELCOM_parseReceivedPacket(uint8_t *dataBufferIn, ELCOM_packet_
 		return err_code;
 	}
 
+	/* The footer must fit in the buffer */
+	if (dataLength > ELCOM_FIELD_LEN_MAX_VALUE) {
+		return ELCOM_INVALID_LEN;
+	}
+
 	/* Verify the footer */
 	err_code = ELCOM_validateEOP(dataBufferIn);
 	if (err_code != ELCOM_NO_ERROR) {
 		return err_code;
 	}
 
-	/* Verify checksum */
-	err_code = ELCOM_validateCheksum(dataBufferIn);
-	if (err_code != ELCOM_NO_ERROR) {
-		return err_code;
+	/* Compute the checksum of the header, then of the data while extracting it */
+	for (i = 0; i < ELCOM_FIELD_HEADER_SIZE; i++) {
+		running_crc = CRC_updateCRC(running_crc, *dataIn++);
 	}
 
-	/* Extract data length */
-	packetOut->dataLength = ELCOM_extractDataLength(dataBufferIn);
+	for (i = 0; i < dataLength; i++) {
+		running_crc = CRC_updateCRC(running_crc, *dataIn);
+		*dataOut++ = *dataIn++;
+	}
 
-	/* Extract command */
-	packetOut->cmd = ELCOM_extractCommand(dataBufferIn);
+	/* Verify checksum (little endian) */
+	packetCrc = dataIn[0] | ((uint16_t)dataIn[1] << 8);
+	if (packetCrc != (running_crc ^ CRC16_FINAL_XOR)) {
+		return ELCOM_INVALID_CRC;
+	}
 
-	/* Extract data */
-	ELCOM_extractData(dataBufferIn, packetOut->data, packetOut->dataLength);
+	packetOut->cmd = dataBufferIn[ELCOM_FIELD_CMD_POS];
+	packetOut->dataLength = dataLength;
 
 	if (ELCOM_CMD_ERROR_SLAVE == packetOut->cmd) {
 		return ELCOM_SLAVE_ERROR;
@@ -125,72 +139,6 @@ static ELCOM_errorCode_t ELCOM_validateEOP(uint8_t *packetData)
 }
 
 
-/**
- *   @brief  Check whether the checksum contained in a received packet
- *   @param  packetData  buffer containing the packet bytes (start of packet at index 0)
- *   @return ELCOM_INVALID_CHECKSUM if there is a checksum error, ELCOM_NO_ERROR otherwise
- **/
-static ELCOM_errorCode_t ELCOM_validateCheksum(uint8_t *packetData)
-{
-	uint8_t dataLength = packetData[ELCOM_FIELD_LEN_POS];
-
-    uint8_t crc_data_length = ELCOM_FIELD_START_OF_PACKET_SIZE +
-                              ELCOM_FIELD_VER_SIZE +
-                              ELCOM_FIELD_LEN_SIZE +
-                              ELCOM_FIELD_CMD_SIZE +
-                              dataLength;
-
-    uint16_t packetCrc = 0;
-    uint16_t computeCrc = 0;
-
-    memcpy(&packetCrc, &packetData[crc_data_length], ELCOM_FIELD_CRC_SIZE);
-
-    computeCrc = CRC_computeCRC(packetData, crc_data_length);
-
-    if (packetCrc != computeCrc) {
-    	return ELCOM_INVALID_CRC;
-    }
-
-    return ELCOM_NO_ERROR;
-}
-
-/**
- *   @brief  Extract the data length in the packet.
- *           Note that the data length differs from the data field value. (It includes also the size of command, cheksum and end of packet field size)
- *   @param  packetData  buffer containing the packet bytes (start of packet at index 0)
- *   @return the data length
- **/
-static uint8_t ELCOM_extractDataLength(uint8_t *packetData)
-{
-    return packetData[ELCOM_FIELD_LEN_POS];
-}
-
-/**
- *   @brief  Extract the command field value
- *   @param  packetData  buffer containing the packet bytes (start of packet at index 0)
- *   @return the command field value
- **/
-static uint8_t ELCOM_extractCommand(uint8_t *packetData)
-{
-	return packetData[ELCOM_FIELD_CMD_POS];
-}
-
-
-/**
- *   @brief  Extract the data from a given packet and place it in a buffer
- *   @param  packetData  buffer containing the packet bytes (start of packet at index 0)
- *   @param  dataOut     buffer to place the extracted data
- *   @param  dataLength  the length of data NOTE : It's not the data field value but the effective data length
- **/
-static void ELCOM_extractData(uint8_t *packetData, uint8_t *dataOut, uint8_t dataLength)
-{
-    if (dataLength > ELCOM_FIELD_DATA_MAX_SIZE) {
-        return;
-    }
-	memcpy(dataOut, &packetData[ELCOM_FIELD_DATA_POS], dataLength);
-}
-
-
 /**
  *   @brief  Construct a ELCOM packet with the values passed in the structured.
  *           The UART buffer is then filled with this packet
@@ -277,6 +225,39 @@ ELCOM_slaveErrorCode_t ELCOM_handleError(ELCOM_errorCode_t errorCode, ELCOM_pack
 }
 
 
+/**
+ *   @brief  Tell whether a response being received is complete, from the number of bytes
+ *           received so far. Runs in constant time and does not need a cleared buffer.
+ *           A complete response still has to go through ELCOM_parseReceivedPacket().
+ *   @param  buffer  buffer receiving the response (start of packet at index 0)
+ *   @param  count   number of bytes received in buffer
+ *   @return ELCOM_RESPONSE_INVALID :  if SOP, VER or LEN already rule out a valid frame
+ *           ELCOM_RESPONSE_COMPLETE :  if the whole frame announced by LEN is received
+ *           ELCOM_RESPONSE_INCOMPLETE otherwise
+ **/
+ELCOM_responseState_t ELCOM_getResponseState(const uint8_t *buffer, uint16_t count)
+{
+	if ((count > ELCOM_FIELD_START_OF_PACKET_POS && buffer[ELCOM_FIELD_START_OF_PACKET_POS] != ELCOM_FIELD_START_OF_PACKET_VALUE)
+			|| (count > ELCOM_FIELD_VER_POS && buffer[ELCOM_FIELD_VER_POS] != ELCOM_FIELD_VER_VALUE)) {
+		return ELCOM_RESPONSE_INVALID;
+	}
+
+	if (count <= ELCOM_FIELD_LEN_POS) {
+		return ELCOM_RESPONSE_INCOMPLETE;
+	}
+
+	if (buffer[ELCOM_FIELD_LEN_POS] > ELCOM_FIELD_LEN_MAX_VALUE) {
+		return ELCOM_RESPONSE_INVALID;
+	}
+
+	if (count < (uint16_t)buffer[ELCOM_FIELD_LEN_POS] + ELCOM_FIELD_HEADER_SIZE + ELCOM_FIELD_FOOTER_SIZE) {
+		return ELCOM_RESPONSE_INCOMPLETE;
+	}
+
+	return ELCOM_RESPONSE_COMPLETE;
+}
+
+
 uint8_t ELCOM_isResponseComplete(uint8_t *buffer)
 {
 	uint8_t dataLength;
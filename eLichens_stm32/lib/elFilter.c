@@ -0,0 +1,302 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include "elFilter.h"
+
+#include <string.h>
+
+
+/********************************************************************
+ * Internal
+ ********************************************************************/
+
+#define ELFILTER_ONE					((int32_t)1 << ELFILTER_FRACTION_BITS)
+#define ELFILTER_GAIN_BITS				(16)	// Fractional bits of the Kalman gain
+
+
+static int32_t ELFILTER_round(int32_t value)
+{
+	return (value + ELFILTER_ONE / 2) >> ELFILTER_FRACTION_BITS;
+}
+
+
+static int32_t ELFILTER_divRound(int32_t value, uint8_t divisor)
+{
+	return (value >= 0) ? (value + divisor / 2) / divisor : (value - divisor / 2) / divisor;
+}
+
+
+static void ELFILTER_initWindow(ELFILTER_stage_t *stage, ELFILTER_type_t type, uint8_t size)
+{
+	memset(stage, 0, sizeof(*stage));
+	stage->type = type;
+	stage->window.size = (0 == size) ? 1 : (size > ELFILTER_WINDOW_MAX_SIZE) ? ELFILTER_WINDOW_MAX_SIZE : size;
+}
+
+
+/**
+ * Push a value in the window, returns the value it replaces (meaningful once the window is full).
+ */
+static int32_t ELFILTER_push(ELFILTER_window_t *window, int32_t value)
+{
+	int32_t oldest = window->window[window->head];
+
+	window->window[window->head] = value;
+	if (++window->head == window->size) {
+		window->head = 0;
+	}
+
+	return oldest;
+}
+
+
+static int32_t ELFILTER_updateMedian(ELFILTER_window_t *window, int32_t value)
+{
+	uint8_t full = (window->count == window->size);
+	int32_t oldest = ELFILTER_push(window, value);
+	uint8_t i = window->count;
+
+	// Remove the oldest value from the sorted copy
+	if (full) {
+		for (i = 0; window->sorted[i] != oldest; i++) {
+		}
+		for (; i + 1 < window->count; i++) {
+			window->sorted[i] = window->sorted[i + 1];
+		}
+	}
+	else {
+		window->count++;
+	}
+
+	// Insertion of the new value
+	for (; i > 0 && window->sorted[i - 1] > value; i--) {
+		window->sorted[i] = window->sorted[i - 1];
+	}
+	window->sorted[i] = value;
+
+	if (window->count & 1) {
+		return window->sorted[window->count / 2];
+	}
+	return ELFILTER_divRound(window->sorted[window->count / 2 - 1] + window->sorted[window->count / 2], 2);
+}
+
+
+static int32_t ELFILTER_updateAverage(ELFILTER_window_t *window, int32_t value)
+{
+	int32_t oldest = ELFILTER_push(window, value);
+
+	if (window->count == window->size) {
+		window->sum -= oldest;
+	}
+	else {
+		window->count++;
+	}
+	window->sum += value;
+
+	return ELFILTER_divRound(window->sum, window->count);
+}
+
+
+static int32_t ELFILTER_updateKalman(ELFILTER_kalman_t *kalman, int32_t value)
+{
+	uint32_t num, den, gain;
+
+	if (0 == kalman->variance) {
+		kalman->state = value * ELFILTER_ONE;
+		kalman->variance = kalman->measurementNoise;
+		return value;
+	}
+
+	// Predict: the concentration follows a random walk
+	kalman->variance += kalman->processNoise;
+
+	// Gain P / (P + R), normalized to stay in 32 bits
+	num = kalman->variance;
+	den = kalman->variance + kalman->measurementNoise;
+	while (den >= ((uint32_t)1 << ELFILTER_GAIN_BITS)) {
+		num >>= 1;
+		den >>= 1;
+	}
+	gain = (den != 0) ? (num << ELFILTER_GAIN_BITS) / den : 0;
+
+	// Update
+	kalman->state += (int32_t)(((int64_t)gain * (value * ELFILTER_ONE - kalman->state)) >> ELFILTER_GAIN_BITS);
+	kalman->variance -= (uint32_t)(((uint64_t)gain * kalman->variance) >> ELFILTER_GAIN_BITS);
+	if (0 == kalman->variance) {
+		kalman->variance = 1;	// 0 means not started
+	}
+
+	return ELFILTER_round(kalman->state);
+}
+
+
+/********************************************************************
+ * Stages
+ ********************************************************************/
+
+/**
+ *   @brief  Exponential moving average stage
+ *   @param  stage  Stage to initialize
+ *   @param  shift  Smoothing: alpha = 1 / 2^shift, 0 lets the values through
+ **/
+void ELFILTER_initEma(ELFILTER_stage_t *stage, uint8_t shift)
+{
+	memset(stage, 0, sizeof(*stage));
+	stage->type = ELFILTER_EMA;
+	stage->ema.shift = shift;
+}
+
+
+/**
+ *   @brief  Sliding median stage, removes spikes shorter than half the window
+ *   @param  stage  Stage to initialize
+ *   @param  size   Window, up to ELFILTER_WINDOW_MAX_SIZE values (odd sizes avoid averaging two values)
+ **/
+void ELFILTER_initMedian(ELFILTER_stage_t *stage, uint8_t size)
+{
+	ELFILTER_initWindow(stage, ELFILTER_MEDIAN, size);
+}
+
+
+/**
+ *   @brief  Moving average stage
+ *   @param  stage  Stage to initialize
+ *   @param  size   Window, up to ELFILTER_WINDOW_MAX_SIZE values
+ **/
+void ELFILTER_initAverage(ELFILTER_stage_t *stage, uint8_t size)
+{
+	ELFILTER_initWindow(stage, ELFILTER_AVERAGE, size);
+}
+
+
+/**
+ *   @brief  1-D Kalman stage, the concentration being modelled as a random walk
+ *   @param  stage             Stage to initialize
+ *   @param  processNoise      Q, variance of the concentration change between two samples, in ppm^2
+ *   @param  measurementNoise  R, variance of the sensor noise, in ppm^2 (not 0)
+ **/
+void ELFILTER_initKalman(ELFILTER_stage_t *stage, uint16_t processNoise, uint16_t measurementNoise)
+{
+	memset(stage, 0, sizeof(*stage));
+	stage->type = ELFILTER_KALMAN;
+	stage->kalman.processNoise = (uint32_t)processNoise << ELFILTER_FRACTION_BITS;
+	stage->kalman.measurementNoise = (uint32_t)measurementNoise << ELFILTER_FRACTION_BITS;
+}
+
+
+/**
+ *   @brief  Feed a value to a single stage
+ *   @param  stage  Stage to update
+ *   @param  value  Input value, in ppm
+ *   @return the filtered value, in ppm
+ **/
+int32_t ELFILTER_stageUpdate(ELFILTER_stage_t *stage, int32_t value)
+{
+	uint8_t primed = stage->primed;
+
+	stage->primed = 1;
+
+	switch (stage->type)
+	{
+	case ELFILTER_EMA:
+		if (!primed) {
+			stage->ema.state = value * ELFILTER_ONE;
+		}
+		else {
+			stage->ema.state += (value * ELFILTER_ONE - stage->ema.state) >> stage->ema.shift;
+		}
+		return ELFILTER_round(stage->ema.state);
+
+	case ELFILTER_MEDIAN:
+		return ELFILTER_updateMedian(&stage->window, value);
+
+	case ELFILTER_AVERAGE:
+		return ELFILTER_updateAverage(&stage->window, value);
+
+	case ELFILTER_KALMAN:
+		return ELFILTER_updateKalman(&stage->kalman, value);
+
+	default:
+		return value;
+	}
+}
+
+
+/********************************************************************
+ * Chain
+ ********************************************************************/
+
+/**
+ *   @brief  Feed a value through all the stages of a chain
+ *   @param  chain  Chain to update
+ *   @param  value  New value, e.g. ELICHENS_SensorData_t.value
+ *   @return the output of the last stage
+ **/
+int32_t ELFILTER_update(ELFILTER_chain_t *chain, int32_t value)
+{
+	uint8_t i;
+
+	for (i = 0; i < chain->count; i++) {
+		value = ELFILTER_stageUpdate(&chain->stages[i], value);
+	}
+
+	return value;
+}
+
+
+/**
+ *   @brief  Forget the history of every stage, e.g. after a gap in the samples.
+ *           The parameters of the stages are kept.
+ *   @param  chain  Chain to reset
+ **/
+void ELFILTER_reset(ELFILTER_chain_t *chain)
+{
+	ELFILTER_stage_t *stage;
+	uint8_t i;
+
+	for (i = 0; i < chain->count; i++) {
+		stage = &chain->stages[i];
+		stage->primed = 0;
+
+		switch (stage->type)
+		{
+		case ELFILTER_MEDIAN:
+		case ELFILTER_AVERAGE:
+			stage->window.count = 0;
+			stage->window.head = 0;
+			stage->window.sum = 0;
+			break;
+
+		case ELFILTER_KALMAN:
+			stage->kalman.variance = 0;
+			break;
+
+		default:
+			break;
+		}
+	}
+}
@@ -0,0 +1,111 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#ifndef __ELMETRICS_H
+#define __ELMETRICS_H
+
+#include <stdint.h>
+#include "elCom.h"
+
+
+/********************************************************************
+ * Metrics parameters
+ ********************************************************************/
+
+#define ELMETRICS_COMMAND_COUNT			(10)	// Commands of elCom.h counted separately
+#define ELMETRICS_COMMAND_OTHER			(ELMETRICS_COMMAND_COUNT)	// Slot of any other command
+#define ELMETRICS_OUTCOME_COUNT			(ELCOM_INVALID_LEN + 2)	// One per ELCOM_errorCode_t, the last one for any other code
+#define ELMETRICS_LATENCY_BINS			(8)		// Bin 0: 0 tick, bin i: [2^(i-1), 2^i) ticks, last bin: longer
+#define ELMETRICS_SNAPSHOT_TRIES		(4)		// Copies attempted while the counters are being updated
+
+
+/********************************************************************
+ * Transaction metrics
+ *
+ * Counters of the transactions of a sensor, updated by the driver
+ * when ELICHENS_Sensor_t.metrics points to them:
+ *
+ *   transactions  per command, ELMETRICS_commands[] gives the command of
+ *                 each slot, the last slot counts any other command
+ *   outcomes      per ELCOM_errorCode_t, ELCOM_NO_ERROR included, as
+ *                 returned by the transport or the parser
+ *   bytes         sent to and received from the sensor
+ *   retries       transactions of the command that failed just before,
+ *                 the driver does not retry by itself so these are the
+ *                 application's
+ *   latency       histogram of the time from the end of the transmission
+ *                 to the complete response, in getTick() ticks, only for
+ *                 the transactions which received one
+ *
+ * The sequence is odd while the driver updates the counters, so that
+ * ELMETRICS_snapshot() can copy them from another context (interrupt,
+ * thread) without locking. ELMETRICS_reset() must run in the context
+ * of the driver.
+ ********************************************************************/
+
+typedef struct {
+	uint32_t		transactions[ELMETRICS_COMMAND_COUNT + 1];		// Per command slot
+	uint32_t		outcomes[ELMETRICS_OUTCOME_COUNT];				// Per ELCOM_errorCode_t
+	uint32_t		bytesTx;
+	uint32_t		bytesRx;
+	uint32_t		retries;
+	uint32_t		latencyMax;										// Longest latency, in ticks
+	uint32_t		latencySum;										// For the average latency
+	uint32_t		latency[ELMETRICS_LATENCY_BINS];				// Histogram of the latencies
+} ELMETRICS_counters_t;
+
+typedef struct {
+	ELMETRICS_counters_t	counters;
+	volatile uint32_t		sequence;								// Odd during an update
+	uint8_t					lastCommand;
+	uint8_t					lastFailed;								// The last transaction did not succeed
+} ELMETRICS_metrics_t;
+
+typedef struct {
+	uint8_t			command;
+	uint8_t			outcome;										// ELCOM_errorCode_t of the transaction
+	uint8_t			bytesTx;
+	uint8_t			complete;										// A response was received, latency is valid
+	uint16_t		bytesRx;
+	uint32_t		latency;										// Ticks from transmission to response
+} ELMETRICS_transaction_t;
+
+extern const uint8_t ELMETRICS_commands[ELMETRICS_COMMAND_COUNT];
+
+
+/********************************************************************
+ * Public functions
+ ********************************************************************/
+
+void ELMETRICS_init(ELMETRICS_metrics_t *metrics);
+void ELMETRICS_record(ELMETRICS_metrics_t *metrics, const ELMETRICS_transaction_t *transaction);
+uint8_t ELMETRICS_snapshot(const ELMETRICS_metrics_t *metrics, ELMETRICS_counters_t *countersOut);
+void ELMETRICS_reset(ELMETRICS_metrics_t *metrics);
+uint8_t ELMETRICS_getCommandSlot(uint8_t command);
+
+
+#endif /* __ELMETRICS_H */
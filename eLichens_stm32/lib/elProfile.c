@@ -0,0 +1,80 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include "elProfile.h"
+
+#if EL_PROFILE
+
+#include <string.h>
+
+
+const volatile uint16_t *ELPROFILE_counter;
+uint16_t ELPROFILE_overhead;
+ELPROFILE_zone_t ELPROFILE_zones[ELPROFILE_ZONE_COUNT];
+
+
+/********************************************************************
+ * Public functions
+ ********************************************************************/
+
+/**
+ *   @brief  Start profiling, measure the cost of the markers and clear the zones
+ *   @param  counter  Free-running counter, already running
+ **/
+void ELPROFILE_init(const volatile uint16_t *counter)
+{
+	uint8_t i;
+
+	ELPROFILE_counter = counter;
+	ELPROFILE_overhead = 0;
+	ELPROFILE_reset();
+
+	// An empty zone, the smallest of a few runs in case an interrupt lands in one
+	for (i = 0; i < 8; i++) {
+		EL_PROFILE_BEGIN(0);
+		EL_PROFILE_END(0);
+	}
+	ELPROFILE_overhead = ELPROFILE_zones[0].min;
+
+	ELPROFILE_reset();
+}
+
+
+/**
+ *   @brief  Clear the zones, e.g. after a dump
+ **/
+void ELPROFILE_reset(void)
+{
+	uint8_t i;
+
+	memset(ELPROFILE_zones, 0, sizeof(ELPROFILE_zones));
+	for (i = 0; i < ELPROFILE_ZONE_COUNT; i++) {
+		ELPROFILE_zones[i].min = UINT16_MAX;
+	}
+}
+
+#endif /* EL_PROFILE */
@@ -0,0 +1,118 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#ifndef __ELPROFILE_H
+#define __ELPROFILE_H
+
+#include <stdint.h>
+
+
+/********************************************************************
+ * Profiler parameters
+ *
+ * Define EL_PROFILE to 1 (compiler flag) to profile the hot paths;
+ * otherwise the zones compile to nothing.
+ ********************************************************************/
+
+#ifndef EL_PROFILE
+#define EL_PROFILE						0
+#endif
+
+#define ELPROFILE_ZONE_PREPARE			(0)		// ELCOM_prepareSendPacket()
+#define ELPROFILE_ZONE_CRC				(1)		// CRC_computeCRC()
+#define ELPROFILE_ZONE_PARSE			(2)		// ELCOM_parseReceivedPacket()
+#define ELPROFILE_ZONE_APP				(3)		// First zone free for the application
+
+#ifndef ELPROFILE_ZONE_COUNT
+#define ELPROFILE_ZONE_COUNT			(8)
+#endif
+
+
+/********************************************************************
+ * Cycle profiler
+ *
+ * A zone counts the ticks of a free-running 16-bit counter between
+ * EL_PROFILE_BEGIN() and EL_PROFILE_END(), once in a block. Clock
+ * the counter from the core clock for cycles, e.g. a timer without
+ * prescaler on STM32 (the Cortex-M0+ has no cycle counter). Zones
+ * must last less than 65536 ticks, include the interrupts that
+ * preempt them and the zones nested in them. The cost of a pair of
+ * markers, measured by ELPROFILE_init(), is taken out.
+ *
+ *   EL_PROFILE_BEGIN(ELPROFILE_ZONE_CRC);
+ *   ...
+ *   EL_PROFILE_END(ELPROFILE_ZONE_CRC);
+ ********************************************************************/
+
+#if EL_PROFILE
+
+typedef struct {
+	uint32_t		count;
+	uint32_t		total;											// Sum of the ticks, for the average
+	uint16_t		min;
+	uint16_t		max;
+} ELPROFILE_zone_t;
+
+extern const volatile uint16_t *ELPROFILE_counter;
+extern uint16_t ELPROFILE_overhead;
+extern ELPROFILE_zone_t ELPROFILE_zones[ELPROFILE_ZONE_COUNT];
+
+void ELPROFILE_init(const volatile uint16_t *counter);
+void ELPROFILE_reset(void);
+
+
+/**
+ * Account for one run of a zone, inline to keep the markers cheap.
+ */
+static inline void ELPROFILE_record(uint8_t zone, uint16_t start)
+{
+	uint16_t ticks = (uint16_t)(*ELPROFILE_counter - start);
+	ELPROFILE_zone_t *z = &ELPROFILE_zones[zone];
+
+	ticks = (ticks > ELPROFILE_overhead) ? ticks - ELPROFILE_overhead : 0;
+	z->count++;
+	z->total += ticks;
+	if (ticks < z->min) {
+		z->min = ticks;
+	}
+	if (ticks > z->max) {
+		z->max = ticks;
+	}
+}
+
+#define EL_PROFILE_BEGIN(zone)			uint16_t elProfileStart_##zone = *ELPROFILE_counter
+#define EL_PROFILE_END(zone)			ELPROFILE_record((zone), elProfileStart_##zone)
+
+#else
+
+#define EL_PROFILE_BEGIN(zone)
+#define EL_PROFILE_END(zone)
+
+#endif /* EL_PROFILE */
+
+
+#endif /* __ELPROFILE_H */
@@ -0,0 +1,86 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#ifndef __ELSCHEDULE_H
+#define __ELSCHEDULE_H
+
+#include <stdint.h>
+
+
+/********************************************************************
+ * Schedule parameters
+ ********************************************************************/
+
+#define ELSCHED_JITTER_BINS				(8)		// Bin 0: on time, bin i: late by [2^(i-1), 2^i) ticks, last bin: later
+
+
+/********************************************************************
+ * Fixed-rate schedule
+ *
+ * Runs are due on absolute deadlines start + n x period, so that the
+ * time spent in a run (three sensor transactions for a sample) does
+ * not add up to the period and the rate does not drift.
+ *
+ * The caller passes the current time, in any monotonic tick unit:
+ * HAL_GetTick() on STM32, millis() on Arduino, CLOCK_MONOTONIC on a
+ * host. Every duration (period, jitter) is in that unit. A run later
+ * than a whole period skips the deadlines it missed instead of
+ * running several times in a row to catch up.
+ *
+ * The period must stay above the time of a run; the sensor itself
+ * does not refresh its data faster than about once per second.
+ ********************************************************************/
+
+typedef struct {
+	uint32_t		period;
+	uint32_t		deadline;										// Next deadline
+	uint32_t		firstRun;										// Time of the first run, for the achieved period
+	uint32_t		lastRun;
+	uint32_t		runs;
+	uint32_t		missed;											// Deadlines skipped
+	uint32_t		jitterMax;										// Largest lateness of a run
+	uint32_t		jitter[ELSCHED_JITTER_BINS];					// Histogram of the lateness of the runs
+} ELSCHED_schedule_t;
+
+
+/********************************************************************
+ * Public functions
+ ********************************************************************/
+
+void ELSCHED_init(ELSCHED_schedule_t *schedule, uint32_t period, uint32_t now);
+void ELSCHED_setPeriod(ELSCHED_schedule_t *schedule, uint32_t period);
+uint8_t ELSCHED_isDue(ELSCHED_schedule_t *schedule, uint32_t now);
+uint32_t ELSCHED_timeUntilDue(const ELSCHED_schedule_t *schedule, uint32_t now);
+uint32_t ELSCHED_getAchievedPeriod(const ELSCHED_schedule_t *schedule, uint32_t scale);
+void ELSCHED_resetStats(ELSCHED_schedule_t *schedule);
+
+#ifdef __unix__
+uint32_t ELSCHED_getMonotonicTick(void);							// CLOCK_MONOTONIC in ms
+#endif
+
+
+#endif /* __ELSCHEDULE_H */
@@ -0,0 +1,435 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include "elStore.h"
+
+#include <string.h>
+
+
+/********************************************************************
+ * Internal
+ ********************************************************************/
+
+static uint32_t ELSTORE_zigzag(int32_t value)
+{
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+
+static int32_t ELSTORE_unzigzag(uint32_t value)
+{
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+
+static uint16_t ELSTORE_putVarint(uint8_t *dataOut, uint32_t value)
+{
+	uint16_t size = 0;
+
+	while (value >= 0x80) {
+		dataOut[size++] = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	dataOut[size++] = (uint8_t)value;
+
+	return size;
+}
+
+
+/**
+ * Decode a varint without reading past end.
+ * Returns 1 on success, 0 if the column ends before the varint.
+ */
+static uint8_t ELSTORE_getVarint(const uint8_t **data, const uint8_t *end, uint32_t *value)
+{
+	uint8_t shift = 0;
+	uint8_t byte;
+
+	*value = 0;
+
+	do {
+		if (*data >= end) {
+			return 0;
+		}
+		byte = *(*data)++;
+		*value |= (uint32_t)(byte & 0x7F) << shift;
+		shift += 7;
+	} while ((byte & 0x80) && shift < 35);
+
+	return 1;
+}
+
+
+static uint16_t ELSTORE_varintSize(uint32_t value)
+{
+	uint16_t size = 1;
+
+	while (value >= 0x80) {
+		value >>= 7;
+		size++;
+	}
+
+	return size;
+}
+
+
+static void ELSTORE_putUint16(uint8_t *dataOut, uint16_t value)
+{
+	dataOut[0] = (uint8_t)value;
+	dataOut[1] = (uint8_t)(value >> 8);
+}
+
+
+static void ELSTORE_putUint32(uint8_t *dataOut, uint32_t value)
+{
+	dataOut[0] = (uint8_t)value;
+	dataOut[1] = (uint8_t)(value >> 8);
+	dataOut[2] = (uint8_t)(value >> 16);
+	dataOut[3] = (uint8_t)(value >> 24);
+}
+
+
+static uint16_t ELSTORE_getUint16(const uint8_t *data)
+{
+	return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+
+static uint32_t ELSTORE_getUint32(const uint8_t *data)
+{
+	return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+
+static int16_t ELSTORE_quantizeTemperature(int16_t temperature)
+{
+	if (temperature >= 0) {
+		return (temperature + ELSTORE_TEMPERATURE_STEP / 2) / ELSTORE_TEMPERATURE_STEP;
+	}
+	return (temperature - ELSTORE_TEMPERATURE_STEP / 2) / ELSTORE_TEMPERATURE_STEP;
+}
+
+
+/**
+ * Close the current run of identical status and error codes.
+ */
+static void ELSTORE_flushStatusRun(ELSTORE_block_t *block)
+{
+	if (0 == block->statusRun) {
+		return;
+	}
+
+	block->statusSize += ELSTORE_putVarint(&block->statusColumn[block->statusSize], block->statusRun);
+	block->statusColumn[block->statusSize++] = block->status;
+	block->statusColumn[block->statusSize++] = block->error;
+	block->statusRun = 0;
+}
+
+
+/**
+ * Give up reading a corrupt block: the next calls of ELSTORE_readerNext() return 0 too.
+ */
+static uint8_t ELSTORE_readerStop(ELSTORE_reader_t *reader)
+{
+	reader->index = reader->count;
+	return 0;
+}
+
+
+/********************************************************************
+ * Writing
+ ********************************************************************/
+
+/**
+ *   @brief  Start a new empty block
+ *   @param  block  Block to initialise
+ **/
+void ELSTORE_blockInit(ELSTORE_block_t *block)
+{
+	block->count = 0;
+	block->statusRun = 0;
+	block->timeSize = 0;
+	block->statusSize = 0;
+	block->ppmSize = 0;
+	block->temperatureSize = 0;
+}
+
+
+/**
+ *   @brief  Append a sample to the block
+ *   @param  block   Block to append to
+ *   @param  sample  Sample to store
+ *   @return 1 on success, 0 if the block is full and must be sealed first
+ **/
+uint8_t ELSTORE_blockAppend(ELSTORE_block_t *block, const ELICHENS_Sample_t *sample)
+{
+	int16_t temperature = ELSTORE_quantizeTemperature(sample->temperature);
+
+	if (block->count >= ELSTORE_BLOCK_SAMPLES) {
+		return 0;
+	}
+
+	if (0 == block->count) {
+		block->runtimeFirst = sample->runtime;
+		block->runtimeMin = sample->runtime;
+		block->runtimeMax = sample->runtime;
+		block->runtimeDelta = 0;
+		block->ppmMin = sample->data.value;
+		block->ppmMax = sample->data.value;
+		block->ppmLast = 0;
+		block->temperatureLast = 0;
+	}
+	else {
+		int32_t delta = (int32_t)(sample->runtime - block->runtimeLast);
+
+		block->timeSize += ELSTORE_putVarint(&block->time[block->timeSize],
+				ELSTORE_zigzag((int32_t)((uint32_t)delta - (uint32_t)block->runtimeDelta)));
+		block->runtimeDelta = delta;
+	}
+	block->runtimeLast = sample->runtime;
+
+	if (sample->runtime < block->runtimeMin) {
+		block->runtimeMin = sample->runtime;
+	}
+	if (sample->runtime > block->runtimeMax) {
+		block->runtimeMax = sample->runtime;
+	}
+	if (sample->data.value < block->ppmMin) {
+		block->ppmMin = sample->data.value;
+	}
+	if (sample->data.value > block->ppmMax) {
+		block->ppmMax = sample->data.value;
+	}
+
+	// Status and error codes seldom change: store runs
+	if (block->statusRun > 0
+			&& (sample->data.status != block->status || sample->data.error != block->error)) {
+		ELSTORE_flushStatusRun(block);
+	}
+	block->status = sample->data.status;
+	block->error = sample->data.error;
+	block->statusRun++;
+
+	block->ppmSize += ELSTORE_putVarint(&block->ppm[block->ppmSize],
+			ELSTORE_zigzag((int32_t)((uint32_t)sample->data.value - (uint32_t)block->ppmLast)));
+	block->ppmLast = sample->data.value;
+
+	block->temperatureSize += ELSTORE_putVarint(&block->temperature[block->temperatureSize],
+			ELSTORE_zigzag(temperature - block->temperatureLast));
+	block->temperatureLast = temperature;
+
+	block->count++;
+
+	return 1;
+}
+
+
+/**
+ *   @brief  Size of the block once sealed
+ *   @param  block  Block to measure
+ *   @return the size in bytes
+ **/
+uint16_t ELSTORE_blockSize(ELSTORE_block_t *block)
+{
+	uint16_t size = ELSTORE_HEADER_SIZE + block->timeSize + block->statusSize + block->ppmSize + block->temperatureSize;
+
+	if (block->statusRun > 0) {
+		size += ELSTORE_varintSize(block->statusRun) + 2;
+	}
+
+	return size;
+}
+
+
+/**
+ *   @brief  Serialise the block, then reset it for the next samples
+ *   @param  block    Block to seal
+ *   @param  dataOut  Destination buffer
+ *   @param  size     Size of dataOut, at least ELSTORE_blockSize()
+ *   @return the number of bytes written, 0 if the block is empty or dataOut too small
+ **/
+uint16_t ELSTORE_blockSeal(ELSTORE_block_t *block, uint8_t *dataOut, uint16_t size)
+{
+	uint16_t blockSize = ELSTORE_blockSize(block);
+	uint8_t *column = dataOut + ELSTORE_HEADER_SIZE;
+
+	if (0 == block->count || size < blockSize) {
+		return 0;
+	}
+
+	ELSTORE_flushStatusRun(block);
+
+	ELSTORE_putUint16(&dataOut[0], blockSize);
+	ELSTORE_putUint16(&dataOut[2], block->count);
+	ELSTORE_putUint32(&dataOut[4], block->runtimeFirst);
+	ELSTORE_putUint32(&dataOut[8], block->runtimeMin);
+	ELSTORE_putUint32(&dataOut[12], block->runtimeMax);
+	ELSTORE_putUint32(&dataOut[16], (uint32_t)block->ppmMin);
+	ELSTORE_putUint32(&dataOut[20], (uint32_t)block->ppmMax);
+	ELSTORE_putUint16(&dataOut[24], block->timeSize);
+	ELSTORE_putUint16(&dataOut[26], block->statusSize);
+	ELSTORE_putUint16(&dataOut[28], block->ppmSize);
+
+	memcpy(column, block->time, block->timeSize);
+	column += block->timeSize;
+	memcpy(column, block->statusColumn, block->statusSize);
+	column += block->statusSize;
+	memcpy(column, block->ppm, block->ppmSize);
+	column += block->ppmSize;
+	memcpy(column, block->temperature, block->temperatureSize);
+
+	ELSTORE_blockInit(block);
+
+	return blockSize;
+}
+
+
+/********************************************************************
+ * Reading
+ ********************************************************************/
+
+/**
+ *   @brief  Open a sealed block for reading
+ *   @param  reader  Reader to initialise
+ *   @param  data    Sealed block
+ *   @param  size    Number of bytes available in data
+ *   @return 1 on success, 0 if data does not hold a complete block
+ **/
+uint8_t ELSTORE_readerInit(ELSTORE_reader_t *reader, const uint8_t *data, uint32_t size)
+{
+	uint32_t timeSize, statusSize, ppmSize;
+
+	if (size < ELSTORE_HEADER_SIZE) {
+		return 0;
+	}
+
+	reader->size = ELSTORE_getUint16(&data[0]);
+	reader->count = ELSTORE_getUint16(&data[2]);
+	reader->runtimeLast = ELSTORE_getUint32(&data[4]);
+	reader->runtimeMin = ELSTORE_getUint32(&data[8]);
+	reader->runtimeMax = ELSTORE_getUint32(&data[12]);
+	reader->ppmMin = (int32_t)ELSTORE_getUint32(&data[16]);
+	reader->ppmMax = (int32_t)ELSTORE_getUint32(&data[20]);
+	timeSize = ELSTORE_getUint16(&data[24]);
+	statusSize = ELSTORE_getUint16(&data[26]);
+	ppmSize = ELSTORE_getUint16(&data[28]);
+
+	// Every sample takes at least one byte in the PPM and TEMPERATURE columns, so does
+	// every sample but the first in the TIME column: the temperature column must fit too
+	if (reader->size > size || 0 == reader->count
+			|| timeSize < reader->count - 1u || ppmSize < reader->count
+			|| ELSTORE_HEADER_SIZE + timeSize + statusSize + ppmSize + reader->count > reader->size) {
+		return 0;
+	}
+
+	reader->time = data + ELSTORE_HEADER_SIZE;
+	reader->timeEnd = reader->time + timeSize;
+	reader->status = reader->timeEnd;
+	reader->statusEnd = reader->status + statusSize;
+	reader->ppm = reader->statusEnd;
+	reader->ppmEnd = reader->ppm + ppmSize;
+	reader->temperature = reader->ppmEnd;
+	reader->temperatureEnd = data + reader->size;
+
+	reader->index = 0;
+	reader->runtimeDelta = 0;
+	reader->ppmLast = 0;
+	reader->temperatureLast = 0;
+	reader->statusRun = 0;
+
+	return 1;
+}
+
+
+/**
+ *   @brief  Decode the next sample of the block
+ *   @param  reader  Reader opened with ELSTORE_readerInit()
+ *   @param  sample  Decoded sample (temperature is rounded to ELSTORE_TEMPERATURE_STEP)
+ *   @return 1 if a sample was decoded, 0 at the end of the block or if a column is overrun
+ **/
+uint8_t ELSTORE_readerNext(ELSTORE_reader_t *reader, ELICHENS_Sample_t *sample)
+{
+	uint32_t value;
+
+	if (reader->index >= reader->count) {
+		return 0;
+	}
+
+	if (reader->index > 0) {
+		if (!ELSTORE_getVarint(&reader->time, reader->timeEnd, &value)) {
+			return ELSTORE_readerStop(reader);
+		}
+		reader->runtimeDelta = (int32_t)((uint32_t)reader->runtimeDelta + (uint32_t)ELSTORE_unzigzag(value));
+		reader->runtimeLast += (uint32_t)reader->runtimeDelta;
+	}
+	sample->runtime = reader->runtimeLast;
+
+	if (0 == reader->statusRun) {
+		if (!ELSTORE_getVarint(&reader->status, reader->statusEnd, &value)
+				|| 0 == value || value > 0xFFFF || reader->statusEnd - reader->status < 2) {
+			return ELSTORE_readerStop(reader);
+		}
+		reader->statusRun = (uint16_t)value;
+		reader->statusLast = *reader->status++;
+		reader->errorLast = *reader->status++;
+	}
+	reader->statusRun--;
+	sample->data.status = reader->statusLast;
+	sample->data.error = reader->errorLast;
+
+	if (!ELSTORE_getVarint(&reader->ppm, reader->ppmEnd, &value)) {
+		return ELSTORE_readerStop(reader);
+	}
+	reader->ppmLast = (int32_t)((uint32_t)reader->ppmLast + (uint32_t)ELSTORE_unzigzag(value));
+	sample->data.value = reader->ppmLast;
+
+	if (!ELSTORE_getVarint(&reader->temperature, reader->temperatureEnd, &value)) {
+		return ELSTORE_readerStop(reader);
+	}
+	reader->temperatureLast += (int16_t)ELSTORE_unzigzag(value);
+	sample->temperature = reader->temperatureLast * ELSTORE_TEMPERATURE_STEP;
+
+	reader->index++;
+
+	return 1;
+}
+
+
+/**
+ *   @brief  Tell from the block header whether some samples may fall in a range, without decoding them
+ *   @param  reader       Reader opened with ELSTORE_readerInit()
+ *   @param  runtimeFrom  First run time of the range
+ *   @param  runtimeTo    Last run time of the range
+ *   @param  ppmFrom      Lowest concentration of the range
+ *   @param  ppmTo        Highest concentration of the range
+ *   @return 1 if the block must be decoded, 0 if it can be skipped
+ **/
+uint8_t ELSTORE_readerOverlaps(ELSTORE_reader_t *reader, uint32_t runtimeFrom, uint32_t runtimeTo, int32_t ppmFrom, int32_t ppmTo)
+{
+	return reader->runtimeMax >= runtimeFrom && reader->runtimeMin <= runtimeTo
+			&& reader->ppmMax >= ppmFrom && reader->ppmMin <= ppmTo;
+}
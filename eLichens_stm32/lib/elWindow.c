@@ -0,0 +1,175 @@
+/*******************************************************************************
+  * COPYRIGHT(c) 2019 Elichens
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include "elWindow.h"
+
+#include <string.h>
+
+
+#define ELWINDOW_ONE					((int32_t)1 << ELWINDOW_FRACTION_BITS)
+
+
+/**
+ * Integer square root, without division.
+ */
+static uint32_t ELWINDOW_sqrt(uint32_t value)
+{
+	uint32_t root = 0;
+	uint32_t bit = (uint32_t)1 << 30;
+
+	while (bit > value) {
+		bit >>= 2;
+	}
+
+	while (0 != bit) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return root;
+}
+
+
+/**
+ * Open a new window at start, the state carrying over from the previous one.
+ */
+static void ELWINDOW_restart(ELWINDOW_window_t *window, uint32_t start)
+{
+	window->start = start;
+	window->count = 0;
+	window->min = 0;
+	window->max = 0;
+	window->mean = 0;
+	window->m2 = 0;
+	window->stateSince = start;
+	memset(window->timeInState, 0, sizeof(window->timeInState));
+}
+
+
+/**
+ * Fill the summary of the current window.
+ */
+static void ELWINDOW_summarize(const ELWINDOW_window_t *window, ELWINDOW_summary_t *summary)
+{
+	uint64_t variance = 0;
+
+	summary->start = window->start;
+	summary->count = window->count;
+	summary->min = window->min;
+	summary->max = window->max;
+	summary->mean = (window->mean + (ELWINDOW_ONE >> 1)) >> ELWINDOW_FRACTION_BITS;
+
+	// Sample variance, rounded
+	if (window->count > 1) {
+		variance = ((window->m2 >> ELWINDOW_FRACTION_BITS) / (window->count - 1) + (ELWINDOW_ONE >> 1))
+				>> ELWINDOW_FRACTION_BITS;
+	}
+	summary->variance = (variance > UINT32_MAX) ? UINT32_MAX : (uint32_t)variance;
+	summary->stddev = ELWINDOW_sqrt(summary->variance);
+
+	memcpy(summary->timeInState, window->timeInState, sizeof(summary->timeInState));
+}
+
+
+/**
+ *   @brief  Open the first window, the sensor being assumed ready until a sample says otherwise
+ *   @param  window  Aggregator to initialize
+ *   @param  length  Window length in ticks
+ *   @param  now     Current time in ticks, start of the first window
+ **/
+void ELWINDOW_init(ELWINDOW_window_t *window, uint32_t length, uint32_t now)
+{
+	memset(window, 0, sizeof(*window));
+
+	window->length = length;
+	window->state = ELGATE_STATE_READY;
+	ELWINDOW_restart(window, now);
+}
+
+
+/**
+ *   @brief  Add a sample, after closing the current window if it is over
+ *   @param  window   Aggregator to update
+ *   @param  data     Sample read with ELCOM_getSenData()
+ *   @param  now      Current time in ticks
+ *   @param  summary  Filled with the summary of the window when it is closed
+ *   @return 1 when a window was closed and summary filled, 0 otherwise
+ **/
+uint8_t ELWINDOW_update(ELWINDOW_window_t *window, const ELICHENS_SensorData_t *data, uint32_t now,
+		ELWINDOW_summary_t *summary)
+{
+	uint32_t elapsed = now - window->start;
+	uint8_t closed = 0;
+	int32_t value, x, delta;
+
+	if (elapsed >= window->length) {
+		window->timeInState[window->state] += window->start + window->length - window->stateSince;
+		ELWINDOW_summarize(window, summary);
+		window->windows++;
+		closed = 1;
+
+		// Next window holding now, on the grid of the first one
+		ELWINDOW_restart(window, now - elapsed % window->length);
+	}
+
+	// The previous state lasted until this sample
+	window->timeInState[window->state] += now - window->stateSince;
+	window->stateSince = now;
+	window->state = ELGATE_classify(data);
+
+	if (ELGATE_STATE_WARMUP == window->state || ELGATE_STATE_CALIBRATION == window->state || 0 != data->error) {
+		return closed;
+	}
+
+	value = data->value;
+	value = (value > ELWINDOW_VALUE_MAX) ? ELWINDOW_VALUE_MAX : value;
+	value = (value < -ELWINDOW_VALUE_MAX) ? -ELWINDOW_VALUE_MAX : value;
+	x = value * ELWINDOW_ONE;
+
+	if (0 == window->count) {
+		window->min = value;
+		window->max = value;
+	}
+	else {
+		window->min = (value < window->min) ? value : window->min;
+		window->max = (value > window->max) ? value : window->max;
+	}
+
+	// Welford: the deviations to the old and to the new mean have the same sign
+	window->count++;
+	delta = x - window->mean;
+	window->mean += delta / (int32_t)window->count;
+	window->m2 += (uint64_t)((int64_t)delta * (x - window->mean));
+
+	return closed;
+}
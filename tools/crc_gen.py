@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""
+Generate and check the tables of the ELCOM CRC16 (BuyPass, see crc_el.h).
+
+The 256 entries table and the 16 entries nibble table of crc_el.c both come
+from this generator. The check mode reads them back from the given sources,
+compares them with the generator and makes sure the three implementations
+selectable with CRC_IMPLEMENTATION (table, nibble, bitwise) agree.
+
+Usage:
+  crc_gen.py                  print the tables as C initializers
+  crc_gen.py --check FILE...  check the tables of FILE (crc_el.c / crc_el.cpp)
+"""
+import random
+import re
+import sys
+
+CRC16_POLY = 0x8005
+CRC16_INIT_REM = 0x0000
+CRC16_FINAL_XOR = 0x0000
+
+
+def table_entry(value, bits):
+    """CRC of value, left aligned in the register, after shifting it out bits by bits."""
+    crc = value << (16 - bits)
+    for _ in range(bits):
+        crc = ((crc << 1) ^ CRC16_POLY if crc & 0x8000 else crc << 1) & 0xFFFF
+    return crc
+
+
+CRC16_TABLE = [table_entry(i, 8) for i in range(256)]
+CRC16_NIBBLE_TABLE = [table_entry(i, 4) for i in range(16)]
+
+
+def crc_table(data):
+    crc = CRC16_INIT_REM
+    for byte in data:
+        crc = CRC16_TABLE[(crc >> 8) ^ byte] ^ ((crc << 8) & 0xFFFF)
+    return crc ^ CRC16_FINAL_XOR
+
+
+def crc_nibble(data):
+    crc = CRC16_INIT_REM
+    for byte in data:
+        crc = CRC16_NIBBLE_TABLE[(crc >> 12) ^ (byte >> 4)] ^ ((crc << 4) & 0xFFFF)
+        crc = CRC16_NIBBLE_TABLE[(crc >> 12) ^ (byte & 0x0F)] ^ ((crc << 4) & 0xFFFF)
+    return crc ^ CRC16_FINAL_XOR
+
+
+def crc_bitwise(data):
+    crc = CRC16_INIT_REM
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ CRC16_POLY if crc & 0x8000 else crc << 1) & 0xFFFF
+    return crc ^ CRC16_FINAL_XOR
+
+
+def format_table(name, size, table):
+    lines = ['const uint16_t %s[%s] CRC_TABLE_ATTR = {' % (name, size)]
+    for i in range(0, len(table), 4):
+        lines.append('\t' + ' '.join('0x%04X,' % v for v in table[i:i + 4]))
+    lines.append('};')
+    return '\n'.join(lines)
+
+
+def read_table(source, name):
+    match = re.search(r'%s\[[^\]]*\][^{]*\{([^}]*)\}' % name, source)
+    if match is None:
+        return None
+    return [int(v, 16) for v in re.findall(r'0x[0-9A-Fa-f]+', match.group(1))]
+
+
+def check(paths):
+    errors = 0
+    for path in paths:
+        with open(path) as f:
+            source = f.read()
+        for name, table in (('crc16Table', CRC16_TABLE), ('crc16NibbleTable', CRC16_NIBBLE_TABLE)):
+            if read_table(source, name) != table:
+                print('%s: %s differs from the generator' % (path, name))
+                errors += 1
+
+    rng = random.Random(0)
+    frames = [b'', b'\x5B\x01\x21\x00'] + [bytes(rng.randrange(256) for _ in range(rng.randrange(1, 256)))
+                                            for _ in range(1000)]
+    for frame in frames:
+        if not crc_table(frame) == crc_nibble(frame) == crc_bitwise(frame):
+            print('implementations disagree on %s' % frame.hex())
+            errors += 1
+
+    print('%d error(s)' % errors)
+    return 1 if errors else 0
+
+
+def main(argv):
+    if len(argv) > 2 and argv[1] == '--check':
+        return check(argv[2:])
+    if len(argv) != 1:
+        sys.stderr.write(__doc__)
+        return 1
+    print(format_table('crc16Table', 'CRC_TABLE_SIZE', CRC16_TABLE))
+    print()
+    print(format_table('crc16NibbleTable', 'CRC_NIBBLE_TABLE_SIZE', CRC16_NIBBLE_TABLE))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,129 @@
+/**
+ * Decode the batched sample frames (see elBatch.h) found in a byte stream,
+ * e.g. the USART2 output of the STM32 sample built with UPLINK_BATCH set to 1.
+ * Text logs and corrupted frames between the frames are skipped.
+ *
+ * Build on host:
+ *   gcc -I../eLichens_stm32/lib -o elbatch_decode elbatch_decode.c \
+ *       ../eLichens_stm32/lib/elBatch.c ../eLichens_stm32/lib/elStore.c \
+ *       ../eLichens_stm32/lib/crc_el.c
+ *
+ * Usage:
+ *   stty -F /dev/ttyACM0 115200 raw && elbatch_decode < /dev/ttyACM0
+ *   elbatch_decode uplink.bin
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "elBatch.h"
+
+
+#define READ_SIZE					(4096)	// Bytes read at most at once
+
+
+static uint32_t frames, samples, skipped;
+
+
+/**
+ * Decode the frame at the start of data, returns its size or 0 if there is none.
+ */
+static uint16_t decodeFrame(const uint8_t *data, uint32_t size)
+{
+	uint8_t block[ELBATCH_PAYLOAD_MAX_SIZE];
+	uint16_t blockSize, frameSize;
+	uint8_t flags;
+	ELSTORE_reader_t reader;
+	ELICHENS_Sample_t sample;
+
+	if (size > ELBATCH_FRAME_MAX_SIZE) {
+		size = ELBATCH_FRAME_MAX_SIZE;
+	}
+
+	blockSize = ELBATCH_decodeFrame(data, (uint16_t)size, block, sizeof(block), &flags);
+	if (0 == blockSize || !ELSTORE_readerInit(&reader, block, blockSize)) {
+		return 0;
+	}
+	frameSize = ELBATCH_FRAME_HEADER_SIZE + (uint16_t)(data[2] | (data[3] << 8)) + ELBATCH_FRAME_CRC_SIZE;
+
+	printf("frame: %u samples ; %u bytes%s ;%s%s%s%s\n", reader.count, frameSize,
+			(flags & ELBATCH_FLAG_LZ) ? " compressed" : "",
+			(flags & ELBATCH_FLAG_SIZE) ? " full" : "", (flags & ELBATCH_FLAG_AGE) ? " age" : "",
+			(flags & ELBATCH_FLAG_ALARM) ? " alarm" : "", (flags & ELBATCH_FLAG_REQUEST) ? " request" : "");
+
+	while (ELSTORE_readerNext(&reader, &sample)) {
+		printf("time = %lu ; ppm = %ld ; status = 0x%02X ; error = 0x%02X ; degC = %.2f\n",
+				(unsigned long)sample.runtime, (long)sample.data.value, sample.data.status, sample.data.error,
+				sample.temperature / 100.);
+		samples++;
+	}
+	frames++;
+
+	return frameSize;
+}
+
+
+int main(int argc, char **argv)
+{
+	static uint8_t data[ELBATCH_FRAME_MAX_SIZE + READ_SIZE];
+	int fd = STDIN_FILENO;
+	uint32_t size = 0, position;
+	uint16_t frameSize;
+	ssize_t count;
+
+	if (argc > 2) {
+		fprintf(stderr, "usage: %s [uplink.bin]\n", argv[0]);
+		return 1;
+	}
+
+	if (2 == argc) {
+		fd = open(argv[1], O_RDONLY);
+		if (fd < 0) {
+			perror(argv[1]);
+			return 1;
+		}
+	}
+
+	do {
+		// Returns what is there: a serial port in raw mode does not wait for a whole buffer
+		count = read(fd, &data[size], sizeof(data) - size);
+		if (count < 0) {
+			if (EINTR == errno) {
+				continue;
+			}
+			perror("read");
+			count = 0;
+		}
+		size += (uint32_t)count;
+
+		// Decode as the data comes, keeping a possibly incomplete frame for the next read
+		position = 0;
+		while (position < size) {
+			if (ELBATCH_FRAME_SYNC == data[position]
+					&& 0 != (frameSize = decodeFrame(&data[position], size - position))) {
+				position += frameSize;
+				continue;
+			}
+			if (0 != count && size - position < ELBATCH_FRAME_MAX_SIZE) {
+				break;
+			}
+			position++;
+			skipped++;
+		}
+		fflush(stdout);
+
+		// Less than a frame is left: there is always room for READ_SIZE more bytes
+		memmove(data, &data[position], size - position);
+		size -= position;
+	} while (0 != count);
+
+	if (STDIN_FILENO != fd) {
+		close(fd);
+	}
+
+	fprintf(stderr, "%lu frames, %lu samples, %lu bytes skipped\n",
+			(unsigned long)frames, (unsigned long)samples, (unsigned long)skipped);
+	return 0;
+}
@@ -0,0 +1,154 @@
+/**
+ * Replay an ELCOM capture (see elCapture.h) through the driver and its decoders,
+ * at full speed and without any sensor attached.
+ *
+ * Build on host:
+ *   gcc -I../eLichens_stm32/lib -o elcap_replay elcap_replay.c \
+ *       ../eLichens_stm32/lib/elCom.c ../eLichens_stm32/lib/crc_el.c \
+ *       ../eLichens_stm32/lib/ELICHENS_driver.c ../eLichens_stm32/lib/elCapture.c \
+ *       ../eLichens_stm32/lib/elMetrics.c
+ *
+ * Usage:
+ *   elcap_replay capture.bin
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ELICHENS_driver.h"
+
+
+static ELICHENS_Sensor_t sensor = {
+	.uartTransmit = &ELCAP_replayTransmit,
+	.uartReceive = &ELCAP_replayReceive,
+	.uartWaitUntilReceived = &ELCAP_replayWaitUntilReceived,
+	.uartAbortReceive = &ELCAP_replayAbortReceive,
+	.getTick = &ELCAP_replayGetTick,
+};
+
+
+static ELCOM_errorCode_t replayTransaction(uint8_t cmd)
+{
+	ELCOM_errorCode_t err_code;
+	char str[24];
+	uint32_t u32;
+	ELICHENS_SensorData_t data;
+	float temperature;
+
+	switch (cmd)
+	{
+	case ELCOM_CMD_GET_MODEL_NAME:
+		err_code = ELCOM_getSysModelName(&sensor, str);
+		printf("model name: '%s'", str);
+		break;
+
+	case ELCOM_CMD_GET_PROD_NAME:
+		err_code = ELCOM_getSysProdName(&sensor, str);
+		printf("product name: '%s'", str);
+		break;
+
+	case ELCOM_CMD_GET_FW_VER:
+		err_code = ELCOM_getSysFwVer(&sensor, str);
+		printf("firmware version: '%s'", str);
+		break;
+
+	case ELCOM_CMD_GET_SEN_SN:
+		err_code = ELCOM_getSysSn(&sensor, &u32);
+		printf("serial number: %lu", (unsigned long)u32);
+		break;
+
+	case ELCOM_CMD_GET_RUN_TIME:
+		err_code = ELCOM_getSysRunTime(&sensor, &u32);
+		printf("runtime: %lu", (unsigned long)u32);
+		break;
+
+	case ELCOM_CMD_GET_SEN_DATA:
+		err_code = ELCOM_getSenData(&sensor, &data);
+		printf("status: 0x%02X ; error: 0x%02X ; ppm: %ld", data.status, data.error, (long)data.value);
+		break;
+
+	case ELCOM_CMD_GET_SEN_TEMP:
+		err_code = ELCOM_getSenTemp(&sensor, &temperature);
+		printf("degC: %.2f", temperature);
+		break;
+
+	case ELCOM_CMD_GET_SEN_DATA_FMT:
+		err_code = ELCOM_getSenDataFmt(&sensor, &sensor.dataFormat);
+		printf("data format: %u %u %u %u", sensor.dataFormat.decimalPoint, sensor.dataFormat.unitCode,
+				sensor.dataFormat.resInt, sensor.dataFormat.resExp);
+		break;
+
+	case ELCOM_CMD_GET_SEN_NAME:
+		err_code = ELCOM_getSenName(&sensor, str);
+		printf("sensor's name: '%s'", str);
+		break;
+
+	default:
+		// Unknown request: skip it along with its response
+		ELCAP_replayTransmit(NULL, 0);
+		ELCAP_replayReceive(sensor.bufferRx);
+		ELCAP_replayWaitUntilReceived();
+		printf("command 0x%02X not decoded", cmd);
+		return ELCOM_COMMAND_UNKNOW;
+	}
+
+	return err_code;
+}
+
+
+int main(int argc, char **argv)
+{
+	FILE *file;
+	long size;
+	uint8_t *capture;
+	uint8_t cmd;
+	uint32_t transactions = 0, failures = 0;
+	clock_t start;
+	double elapsed;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s capture.bin\n", argv[0]);
+		return 1;
+	}
+
+	file = fopen(argv[1], "rb");
+	if (NULL == file) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	capture = malloc(size > 0 ? size : 1);
+	if (NULL == capture || fread(capture, 1, size, file) != (size_t)size) {
+		fprintf(stderr, "failed to read %s\n", argv[1]);
+		fclose(file);
+		return 1;
+	}
+	fclose(file);
+
+	ELCAP_replayBegin(capture, size, &sensor.rxLength);
+	start = clock();
+
+	while (0 != (cmd = ELCAP_replayNextCommand())) {
+		ELCOM_errorCode_t err_code;
+
+		err_code = replayTransaction(cmd);
+		printf(" @ %lu ms", (unsigned long)ELCAP_replayGetTick());
+		if (ELCOM_NO_ERROR != err_code) {
+			printf(" ; error: 0x%02X", err_code);
+			failures++;
+		}
+		printf("\n");
+		transactions++;
+	}
+
+	elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+	fprintf(stderr, "%lu transactions, %lu failed, replayed in %.3f s\n",
+			(unsigned long)transactions, (unsigned long)failures, elapsed);
+
+	free(capture);
+	return 0;
+}
@@ -0,0 +1,258 @@
+/**
+ * Replay the concentrations of ELCOM captures (see elCapture.h) through the
+ * change-point detector (see elChange.h): reports when each chart fires on
+ * every trace, then the cost per sample of ELCHANGE_update() on one stream
+ * and of ELCHANGE_updateBatch() on many streams, as on a gateway.
+ *
+ * Build on host:
+ *   gcc -O3 -march=native -I../eLichens_stm32/lib -o elchange_bench elchange_bench.c \
+ *       ../eLichens_stm32/lib/elCom.c ../eLichens_stm32/lib/crc_el.c \
+ *       ../eLichens_stm32/lib/ELICHENS_driver.c ../eLichens_stm32/lib/elCapture.c \
+ *       ../eLichens_stm32/lib/elChange.c ../eLichens_stm32/lib/elMetrics.c
+ *   (-O3 lets gcc vectorize ELCHANGE_updateBatch(), -march=native on the host's SIMD width)
+ *
+ * Usage:
+ *   elchange_bench [-n streams] [-k allowance] [-c cusumLimit] [-e ewmaLimit] capture.bin...
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ELICHENS_driver.h"
+#include "elChange.h"
+
+
+#define BENCH_SAMPLES			(20000000UL)	// Samples processed by each timed run
+
+
+static ELICHENS_Sensor_t sensor = {
+	.uartTransmit = &ELCAP_replayTransmit,
+	.uartReceive = &ELCAP_replayReceive,
+	.uartWaitUntilReceived = &ELCAP_replayWaitUntilReceived,
+	.uartAbortReceive = &ELCAP_replayAbortReceive,
+	.getTick = &ELCAP_replayGetTick,
+};
+
+static int32_t *values;
+static uint32_t *times;
+static uint32_t count;
+static uint32_t capacity;
+
+
+static void appendValue(int32_t value, uint32_t time)
+{
+	if (count == capacity) {
+		capacity = capacity ? 2 * capacity : 1024;
+		values = realloc(values, capacity * sizeof(*values));
+		times = realloc(times, capacity * sizeof(*times));
+		if (NULL == values || NULL == times) {
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+	values[count] = value;
+	times[count] = time;
+	count++;
+}
+
+
+/**
+ * Append the concentrations of a capture to the trace, decoded by the driver.
+ */
+static int loadCapture(const char *path)
+{
+	FILE *file;
+	long size;
+	uint8_t *capture;
+	uint8_t cmd;
+	ELICHENS_SensorData_t data;
+
+	file = fopen(path, "rb");
+	if (NULL == file) {
+		perror(path);
+		return 0;
+	}
+
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	capture = malloc(size > 0 ? size : 1);
+	if (NULL == capture || fread(capture, 1, size, file) != (size_t)size) {
+		fprintf(stderr, "failed to read %s\n", path);
+		fclose(file);
+		free(capture);
+		return 0;
+	}
+	fclose(file);
+
+	ELCAP_replayBegin(capture, size, &sensor.rxLength);
+
+	while (0 != (cmd = ELCAP_replayNextCommand())) {
+		if (ELCOM_CMD_GET_SEN_DATA == cmd) {
+			if (ELCOM_NO_ERROR == ELCOM_getSenData(&sensor, &data) && 0 == data.error) {
+				appendValue(data.value, ELCAP_replayGetTick());
+			}
+		}
+		else {
+			// Not a concentration: skip the request along with its response
+			ELCAP_replayTransmit(NULL, 0);
+			ELCAP_replayReceive(sensor.bufferRx);
+			ELCAP_replayWaitUntilReceived();
+		}
+	}
+
+	free(capture);
+	return 1;
+}
+
+
+/**
+ * Print the changes of verdict of the detector along a trace.
+ */
+static void reportDetections(const char *path, uint32_t first, uint32_t last, const ELCHANGE_detector_t *init)
+{
+	ELCHANGE_detector_t detector = *init;
+	uint8_t flags, previous = 0;
+	uint32_t i;
+
+	printf("%s: %lu samples\n", path, (unsigned long)(last - first));
+
+	for (i = first; i < last; i++) {
+		flags = ELCHANGE_update(&detector, values[i]);
+		if (flags != previous) {
+			printf("  sample %lu @ %lu ms, %ld ppm, baseline %ld ppm: %s%s%s\n",
+					(unsigned long)(i - first), (unsigned long)times[i], (long)values[i],
+					(long)(detector.baseline >> ELCHANGE_FRACTION_BITS),
+					flags ? "change" : "over",
+					(flags & ELCHANGE_CUSUM) ? " cusum" : "", (flags & ELCHANGE_EWMA) ? " ewma" : "");
+			previous = flags;
+		}
+	}
+}
+
+
+int main(int argc, char **argv)
+{
+	ELCHANGE_detector_t detector;
+	ELCHANGE_batch_t batch;
+	uint32_t allowance = 10, cusumLimit = 200, ewmaLimit = 15;
+	uint32_t streams = 4096;
+	uint32_t first, i, s, rounds, mismatches = 0;
+	int32_t *row;
+	uint32_t checksum = 0;
+	clock_t start;
+	double scalar, batched;
+	int arg;
+
+	for (arg = 1; arg + 1 < argc && '-' == argv[arg][0]; arg += 2) {
+		uint32_t value = (uint32_t)strtoul(argv[arg + 1], NULL, 0);
+
+		if (0 == strcmp(argv[arg], "-n") && value > 0) {
+			streams = value;
+		}
+		else if (0 == strcmp(argv[arg], "-k")) {
+			allowance = value;
+		}
+		else if (0 == strcmp(argv[arg], "-c")) {
+			cusumLimit = value;
+		}
+		else if (0 == strcmp(argv[arg], "-e")) {
+			ewmaLimit = value;
+		}
+		else {
+			break;
+		}
+	}
+
+	if (arg >= argc) {
+		fprintf(stderr, "usage: %s [-n streams] [-k allowance] [-c cusumLimit] [-e ewmaLimit] capture.bin...\n", argv[0]);
+		return 1;
+	}
+
+	ELCHANGE_init(&detector, allowance, cusumLimit, ewmaLimit);
+
+	for (; arg < argc; arg++) {
+		first = count;
+		if (!loadCapture(argv[arg])) {
+			return 1;
+		}
+		reportDetections(argv[arg], first, count, &detector);
+	}
+
+	if (0 == count) {
+		fprintf(stderr, "no concentration in the captures\n");
+		return 1;
+	}
+
+	// One stream, the traces replayed end to end
+	rounds = (uint32_t)(BENCH_SAMPLES / count) + 1;
+	start = clock();
+	for (s = 0; s < rounds; s++) {
+		ELCHANGE_detector_t d = detector;
+
+		for (i = 0; i < count; i++) {
+			checksum += ELCHANGE_update(&d, values[i]);
+		}
+	}
+	scalar = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / ((double)rounds * count);
+
+	// Many streams, stream s replaying the traces from sample s
+	batch.config = &detector.config;
+	batch.count = streams;
+	batch.baseline = malloc(streams * sizeof(int32_t));
+	batch.cusum = malloc(streams * sizeof(int32_t));
+	batch.ewma = malloc(streams * sizeof(int32_t));
+	batch.flags = malloc(streams);
+	row = malloc(streams * sizeof(int32_t));
+	if (NULL == batch.baseline || NULL == batch.cusum || NULL == batch.ewma || NULL == batch.flags || NULL == row) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	rounds = (uint32_t)(BENCH_SAMPLES / streams) + 1;
+	for (s = 0; s < streams; s++) {
+		row[s] = values[s % count];
+	}
+	ELCHANGE_startBatch(&batch, row);
+
+	// The batch must give the same verdicts as the detector of a single stream
+	{
+		ELCHANGE_detector_t d = detector;
+
+		ELCHANGE_update(&d, values[0]);
+		for (i = 1; i < rounds; i++) {
+			for (s = 0; s < streams; s++) {
+				row[s] = values[(s + i) % count];
+			}
+			ELCHANGE_updateBatch(&batch, row);
+			if (batch.flags[0] != ELCHANGE_update(&d, values[i % count])) {
+				mismatches++;
+			}
+		}
+	}
+
+	// Timed without the gathering of the rows, as a gateway receives them ready
+	ELCHANGE_startBatch(&batch, row);
+	start = clock();
+	for (i = 0; i < rounds; i++) {
+		row[i % streams] = values[i % count];
+		ELCHANGE_updateBatch(&batch, row);
+		checksum += batch.flags[i % streams];
+	}
+	batched = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / ((double)rounds * streams);
+
+	printf("single stream: %.2f ns/sample\n", scalar);
+	printf("%lu streams: %.2f ns/sample, %lu mismatch(es) with the single stream (checksum %lu)\n",
+			(unsigned long)streams, batched, (unsigned long)mismatches, (unsigned long)checksum);
+
+	free(batch.baseline);
+	free(batch.cusum);
+	free(batch.ewma);
+	free(batch.flags);
+	free(row);
+	free(values);
+	free(times);
+	return mismatches ? 1 : 0;
+}
@@ -0,0 +1,556 @@
+/**
+ * Poll eLichens sensors on the serial ports of a Linux gateway and export the
+ * transaction metrics of the driver (see elMetrics.h) in the Prometheus text
+ * format, over HTTP on localhost or on a Unix socket.
+ *
+ * The main thread takes the samples on a fixed-rate schedule, one port after
+ * the other, and a server thread answers the scrapes: a slow scraper never
+ * delays the sampling. The server reads the counters with ELMETRICS_snapshot()
+ * while the driver updates them, so they are not locked; only the last samples
+ * and the loop counters are.
+ *
+ * Build on host:
+ *   gcc -pthread -I../eLichens_stm32/lib -o elmetrics_exporter elmetrics_exporter.c \
+ *       ../eLichens_stm32/lib/elCom.c ../eLichens_stm32/lib/crc_el.c \
+ *       ../eLichens_stm32/lib/ELICHENS_driver.c ../eLichens_stm32/lib/elCapture.c \
+ *       ../eLichens_stm32/lib/elMetrics.c ../eLichens_stm32/lib/elSchedule.c
+ *
+ * Usage:
+ *   elmetrics_exporter [-l tcp_port | -u socket_path] [-p period_ms] /dev/ttyUSB0...
+ *   curl http://127.0.0.1:9464/metrics
+ *   curl --unix-socket /run/elmetrics.sock http://localhost/metrics
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "ELICHENS_driver.h"
+#include "elSchedule.h"
+
+
+#define EXPORTER_TCP_PORT			(9464)	// Default port, bound to 127.0.0.1 only
+#define EXPORTER_PERIOD_MS			(1000)	// Default time between two samples of a port
+#define EXPORTER_RESPONSE_TIMEOUT_MS	(250)	// As the examples: longest wait for a response
+#define EXPORTER_REQUEST_TIMEOUT_MS	(100)	// Longest wait for the request of a scraper
+#define EXPORTER_REQUEST_MAX_SIZE	(1024)
+
+
+typedef struct {
+	const char				*path;
+	int						fd;
+	ELICHENS_Sensor_t		sensor;
+	ELMETRICS_metrics_t		metrics;
+	ELMETRICS_counters_t	exported;		// Last consistent copy of the counters, server thread only
+	ELICHENS_SensorData_t	data;			// Last sample, under lock
+	uint8_t					valid;			// data holds a sample, under lock
+} port_t;
+
+static port_t *ports;
+static int portCount;
+static port_t *current;						// Port of the transaction in progress, for the callbacks
+static uint8_t *rxBuffer;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;	// Last samples and loop counters
+static ELSCHED_schedule_t schedule;
+static uint32_t loopStart;
+static uint64_t loopBusy;					// Time spent sampling, in ms, under lock
+static uint32_t loopMissed;					// Copy of schedule.missed, under lock
+static uint32_t scrapes;					// Server thread only
+
+static const char * const outcomeNames[ELMETRICS_OUTCOME_COUNT] = {
+	"no_error", "invalid_sop", "invalid_ver", "invalid_crc", "invalid_eop",
+	"command_unknown", "slave_timeout", "slave_error", "invalid_len", "other",
+};
+
+
+/********************************************************************
+ * Serial transport of the current port
+ ********************************************************************/
+
+static ELCOM_errorCode_t serialTransmit(uint8_t *data, uint16_t size)
+{
+	ssize_t written;
+
+	while (size > 0) {
+		written = write(current->fd, data, size);
+		if (written < 0) {
+			if (EINTR == errno) {
+				continue;
+			}
+			return ELCOM_SLAVE_ERROR;
+		}
+		data += written;
+		size -= (uint16_t)written;
+	}
+
+	// Until the last byte is on the wire, so that the latency starts at the end of the transmission
+	tcdrain(current->fd);
+
+	return ELCOM_NO_ERROR;
+}
+
+
+static ELCOM_errorCode_t serialReceive(uint8_t *data)
+{
+	// Drop whatever came in since the last transaction
+	tcflush(current->fd, TCIFLUSH);
+	rxBuffer = data;
+
+	return ELCOM_NO_ERROR;
+}
+
+
+static ELCOM_errorCode_t serialWaitUntilReceived(void)
+{
+	uint32_t start = ELSCHED_getMonotonicTick();
+	uint32_t elapsed;
+	struct pollfd pfd = { current->fd, POLLIN, 0 };
+	ssize_t count;
+
+	while ((elapsed = ELSCHED_getMonotonicTick() - start) < EXPORTER_RESPONSE_TIMEOUT_MS) {
+		if (poll(&pfd, 1, EXPORTER_RESPONSE_TIMEOUT_MS - elapsed) <= 0) {
+			continue;
+		}
+
+		count = read(current->fd, &rxBuffer[current->sensor.rxLength],
+				ELCOM_DATA_BUFFER_SIZE - current->sensor.rxLength);
+		if (count <= 0) {
+			if (count < 0 && EINTR != errno && EAGAIN != errno) {
+				return ELCOM_SLAVE_ERROR;
+			}
+			continue;
+		}
+		current->sensor.rxLength += (uint16_t)count;
+
+		if (ELCOM_RESPONSE_INCOMPLETE != ELCOM_getResponseState(rxBuffer, current->sensor.rxLength)) {
+			// Complete, or invalid and left to ELCOM_parseReceivedPacket() to report
+			return ELCOM_NO_ERROR;
+		}
+	}
+
+	return ELCOM_SLAVE_TIMEOUT;
+}
+
+
+static void serialAbortReceive(void)
+{
+	rxBuffer = NULL;
+}
+
+
+static int openPort(port_t *port, const char *path)
+{
+	struct termios tio;
+
+	port->path = path;
+	port->fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (port->fd < 0) {
+		perror(path);
+		return 0;
+	}
+
+	// 57600 8N1, raw, as the sensor UART of the examples
+	if (tcgetattr(port->fd, &tio) < 0) {
+		perror(path);
+		return 0;
+	}
+	cfmakeraw(&tio);
+	cfsetispeed(&tio, B57600);
+	cfsetospeed(&tio, B57600);
+	tio.c_cflag |= CLOCAL | CREAD;
+	if (tcsetattr(port->fd, TCSANOW, &tio) < 0) {
+		perror(path);
+		return 0;
+	}
+
+	port->sensor.uartTransmit = &serialTransmit;
+	port->sensor.uartReceive = &serialReceive;
+	port->sensor.uartWaitUntilReceived = &serialWaitUntilReceived;
+	port->sensor.uartAbortReceive = &serialAbortReceive;
+	port->sensor.getTick = &ELSCHED_getMonotonicTick;
+	port->sensor.metrics = &port->metrics;
+	ELMETRICS_init(&port->metrics);
+
+	return 1;
+}
+
+
+/********************************************************************
+ * Prometheus text format
+ ********************************************************************/
+
+static void writeHeader(FILE *out, const char *name, const char *type, const char *help)
+{
+	fprintf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+
+static void writeMetrics(FILE *out)
+{
+	ELMETRICS_counters_t *counters;
+	ELICHENS_SensorData_t *data;
+	uint8_t *valid;
+	uint64_t busy;
+	uint32_t missed, cumulative;
+	int p, i, queued;
+
+	// Copy everything first, so that all the metrics of a scrape agree
+	counters = calloc(portCount, sizeof(*counters));
+	data = calloc(portCount, sizeof(*data));
+	valid = calloc(portCount, sizeof(*valid));
+	if (NULL == counters || NULL == data || NULL == valid) {
+		free(counters);
+		free(data);
+		free(valid);
+		return;
+	}
+	for (p = 0; p < portCount; p++) {
+		// A torn copy could make a counter go backwards, which reads as a reset: export the last good one
+		if (ELMETRICS_snapshot(&ports[p].metrics, &counters[p])) {
+			ports[p].exported = counters[p];
+		}
+		else {
+			counters[p] = ports[p].exported;
+		}
+	}
+	pthread_mutex_lock(&lock);
+	for (p = 0; p < portCount; p++) {
+		data[p] = ports[p].data;
+		valid[p] = ports[p].valid;
+	}
+	busy = loopBusy;
+	missed = loopMissed;
+	pthread_mutex_unlock(&lock);
+
+	writeHeader(out, "elcom_transactions_total", "counter", "Transactions with the sensor, per command.");
+	for (p = 0; p < portCount; p++) {
+		for (i = 0; i <= ELMETRICS_COMMAND_COUNT; i++) {
+			if (i < ELMETRICS_COMMAND_COUNT) {
+				fprintf(out, "elcom_transactions_total{port=\"%s\",command=\"0x%02X\"} %lu\n", ports[p].path,
+						ELMETRICS_commands[i], (unsigned long)counters[p].transactions[i]);
+			}
+			else {
+				fprintf(out, "elcom_transactions_total{port=\"%s\",command=\"other\"} %lu\n", ports[p].path,
+						(unsigned long)counters[p].transactions[i]);
+			}
+		}
+	}
+
+	writeHeader(out, "elcom_outcomes_total", "counter", "Transactions per ELCOM_errorCode_t returned.");
+	for (p = 0; p < portCount; p++) {
+		for (i = 0; i < ELMETRICS_OUTCOME_COUNT; i++) {
+			fprintf(out, "elcom_outcomes_total{port=\"%s\",outcome=\"%s\"} %lu\n", ports[p].path,
+					outcomeNames[i], (unsigned long)counters[p].outcomes[i]);
+		}
+	}
+
+	writeHeader(out, "elcom_retries_total", "counter", "Transactions of a command that failed just before.");
+	for (p = 0; p < portCount; p++) {
+		fprintf(out, "elcom_retries_total{port=\"%s\"} %lu\n", ports[p].path, (unsigned long)counters[p].retries);
+	}
+
+	writeHeader(out, "elcom_tx_bytes_total", "counter", "Bytes sent to the sensor.");
+	for (p = 0; p < portCount; p++) {
+		fprintf(out, "elcom_tx_bytes_total{port=\"%s\"} %lu\n", ports[p].path, (unsigned long)counters[p].bytesTx);
+	}
+
+	writeHeader(out, "elcom_rx_bytes_total", "counter", "Bytes received from the sensor.");
+	for (p = 0; p < portCount; p++) {
+		fprintf(out, "elcom_rx_bytes_total{port=\"%s\"} %lu\n", ports[p].path, (unsigned long)counters[p].bytesRx);
+	}
+
+	// Bin i of the driver holds [2^(i-1), 2^i) ms, that is up to 2^i - 1 ms
+	writeHeader(out, "elcom_latency_milliseconds", "histogram",
+			"Time from the end of the transmission to the complete response.");
+	for (p = 0; p < portCount; p++) {
+		cumulative = 0;
+		for (i = 0; i < ELMETRICS_LATENCY_BINS; i++) {
+			cumulative += counters[p].latency[i];
+			if (i < ELMETRICS_LATENCY_BINS - 1) {
+				fprintf(out, "elcom_latency_milliseconds_bucket{port=\"%s\",le=\"%lu\"} %lu\n", ports[p].path,
+						(1UL << i) - 1, (unsigned long)cumulative);
+			}
+			else {
+				fprintf(out, "elcom_latency_milliseconds_bucket{port=\"%s\",le=\"+Inf\"} %lu\n", ports[p].path,
+						(unsigned long)cumulative);
+			}
+		}
+		fprintf(out, "elcom_latency_milliseconds_sum{port=\"%s\"} %lu\n", ports[p].path,
+				(unsigned long)counters[p].latencySum);
+		fprintf(out, "elcom_latency_milliseconds_count{port=\"%s\"} %lu\n", ports[p].path, (unsigned long)cumulative);
+	}
+
+	writeHeader(out, "elcom_latency_max_milliseconds", "gauge", "Longest latency of a response.");
+	for (p = 0; p < portCount; p++) {
+		fprintf(out, "elcom_latency_max_milliseconds{port=\"%s\"} %lu\n", ports[p].path,
+				(unsigned long)counters[p].latencyMax);
+	}
+
+	writeHeader(out, "elcom_rx_queue_bytes", "gauge", "Bytes waiting in the receive queue of the port.");
+	for (p = 0; p < portCount; p++) {
+		queued = 0;
+		ioctl(ports[p].fd, FIONREAD, &queued);
+		fprintf(out, "elcom_rx_queue_bytes{port=\"%s\"} %d\n", ports[p].path, queued);
+	}
+
+	writeHeader(out, "elcom_tx_queue_bytes", "gauge", "Bytes waiting in the transmit queue of the port.");
+	for (p = 0; p < portCount; p++) {
+		queued = 0;
+		ioctl(ports[p].fd, TIOCOUTQ, &queued);
+		fprintf(out, "elcom_tx_queue_bytes{port=\"%s\"} %d\n", ports[p].path, queued);
+	}
+
+	writeHeader(out, "elichens_concentration_ppm", "gauge", "Last concentration read from the sensor.");
+	for (p = 0; p < portCount; p++) {
+		if (valid[p]) {
+			fprintf(out, "elichens_concentration_ppm{port=\"%s\"} %ld\n", ports[p].path, (long)data[p].value);
+		}
+	}
+
+	writeHeader(out, "elcom_loop_busy_seconds_total", "counter",
+			"Time the sampling loop spent busy, its rate is the utilization.");
+	fprintf(out, "elcom_loop_busy_seconds_total %.3f\n", busy / 1000.);
+
+	writeHeader(out, "elcom_loop_seconds_total", "counter", "Time since the sampling loop started.");
+	fprintf(out, "elcom_loop_seconds_total %.3f\n", (ELSCHED_getMonotonicTick() - loopStart) / 1000.);
+
+	writeHeader(out, "elcom_loop_missed_total", "counter", "Sampling rounds skipped because the loop was late.");
+	fprintf(out, "elcom_loop_missed_total %lu\n", (unsigned long)missed);
+
+	writeHeader(out, "elcom_scrapes_total", "counter", "Scrapes served.");
+	fprintf(out, "elcom_scrapes_total %lu\n", (unsigned long)scrapes);
+
+	free(counters);
+	free(data);
+	free(valid);
+}
+
+
+/********************************************************************
+ * Server
+ ********************************************************************/
+
+static int listenTcp(uint16_t port)
+{
+	struct sockaddr_in addr;
+	int fd, one = 1;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0) {
+		perror("socket");
+		return -1;
+	}
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0) {
+		perror("bind");
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+
+static int listenUnix(const char *path)
+{
+	struct sockaddr_un addr;
+	int fd;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "%s: path too long\n", path);
+		return -1;
+	}
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		perror("socket");
+		return -1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	unlink(path);
+
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0) {
+		perror(path);
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+
+/**
+ * Answer one scrape. The request is read with a short timeout, so that a
+ * stuck client cannot hold the next scrapes back.
+ */
+static void serve(int listenFd)
+{
+	char request[EXPORTER_REQUEST_MAX_SIZE + 1];
+	struct pollfd pfd;
+	size_t length = 0;
+	ssize_t count;
+	char *body = NULL;
+	size_t bodySize = 0;
+	FILE *out;
+	int fd;
+
+	fd = accept(listenFd, NULL, NULL);
+	if (fd < 0) {
+		return;
+	}
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	while (length < EXPORTER_REQUEST_MAX_SIZE && poll(&pfd, 1, EXPORTER_REQUEST_TIMEOUT_MS) > 0) {
+		count = read(fd, &request[length], EXPORTER_REQUEST_MAX_SIZE - length);
+		if (count <= 0) {
+			break;
+		}
+		length += (size_t)count;
+		request[length] = 0;
+		if (NULL != strstr(request, "\r\n\r\n") || NULL != strstr(request, "\n\n")) {
+			break;
+		}
+	}
+	request[length] = 0;
+
+	if (0 != strncmp(request, "GET /metrics ", 13) && 0 != strncmp(request, "GET / ", 6)) {
+		dprintf(fd, "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+		close(fd);
+		return;
+	}
+
+	out = open_memstream(&body, &bodySize);
+	if (NULL != out) {
+		scrapes++;
+		writeMetrics(out);
+		fclose(out);
+		dprintf(fd, "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+				"Content-Length: %lu\r\nConnection: close\r\n\r\n", (unsigned long)bodySize);
+		if (write(fd, body, bodySize) < 0) {
+			// The scraper went away, nothing to do
+		}
+		free(body);
+	}
+	close(fd);
+}
+
+
+static void *serverThread(void *argument)
+{
+	int listenFd = (int)(intptr_t)argument;
+
+	for (;;) {
+		serve(listenFd);
+	}
+
+	return NULL;
+}
+
+
+int main(int argc, char **argv)
+{
+	const char *unixPath = NULL;
+	uint16_t tcpPort = EXPORTER_TCP_PORT;
+	uint32_t period = EXPORTER_PERIOD_MS;
+	uint32_t start;
+	ELICHENS_SensorData_t data;
+	uint8_t valid;
+	pthread_t server;
+	int listenFd, arg, p;
+
+	for (arg = 1; arg + 1 < argc && '-' == argv[arg][0]; arg += 2) {
+		if (0 == strcmp(argv[arg], "-l")) {
+			tcpPort = (uint16_t)strtoul(argv[arg + 1], NULL, 0);
+		}
+		else if (0 == strcmp(argv[arg], "-u")) {
+			unixPath = argv[arg + 1];
+		}
+		else if (0 == strcmp(argv[arg], "-p") && strtoul(argv[arg + 1], NULL, 0) > 0) {
+			period = (uint32_t)strtoul(argv[arg + 1], NULL, 0);
+		}
+		else {
+			break;
+		}
+	}
+
+	if (arg >= argc) {
+		fprintf(stderr, "usage: %s [-l tcp_port | -u socket_path] [-p period_ms] /dev/ttyUSB0...\n", argv[0]);
+		return 1;
+	}
+
+	portCount = argc - arg;
+	ports = calloc(portCount, sizeof(*ports));
+	if (NULL == ports) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	for (p = 0; p < portCount; p++) {
+		if (!openPort(&ports[p], argv[arg + p])) {
+			return 1;
+		}
+	}
+
+	listenFd = (NULL != unixPath) ? listenUnix(unixPath) : listenTcp(tcpPort);
+	if (listenFd < 0) {
+		return 1;
+	}
+
+	// A scraper closing early must not kill the exporter
+	signal(SIGPIPE, SIG_IGN);
+
+	loopStart = ELSCHED_getMonotonicTick();
+	ELSCHED_init(&schedule, period, loopStart);
+
+	if (0 != pthread_create(&server, NULL, &serverThread, (void *)(intptr_t)listenFd)) {
+		fprintf(stderr, "cannot start the server thread\n");
+		return 1;
+	}
+
+	for (;;) {
+		if (ELSCHED_isDue(&schedule, ELSCHED_getMonotonicTick())) {
+			start = ELSCHED_getMonotonicTick();
+			for (p = 0; p < portCount; p++) {
+				current = &ports[p];
+				valid = (ELCOM_NO_ERROR == ELCOM_getSenData(&ports[p].sensor, &data));
+
+				pthread_mutex_lock(&lock);
+				ports[p].data = data;
+				ports[p].valid = valid;
+				pthread_mutex_unlock(&lock);
+			}
+			current = NULL;
+
+			pthread_mutex_lock(&lock);
+			loopBusy += ELSCHED_getMonotonicTick() - start;
+			loopMissed = schedule.missed;
+			pthread_mutex_unlock(&lock);
+		}
+
+		// Sleep until the next round
+		usleep(1000 * ELSCHED_timeUntilDue(&schedule, ELSCHED_getMonotonicTick()));
+	}
+
+	return 0;
+}
@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+"""
+Decode the deferred logs of the STM32 sample (LOG_DEFERRED set to 1 in main.h).
+
+The format strings are read from the .logfmt section of the firmware ELF file;
+the frames (see log_deferred.h) are read from a file or from stdin.
+
+Usage:
+  stty -F /dev/ttyACM0 115200 raw && logdecode.py demo-ch4.elf < /dev/ttyACM0
+  logdecode.py demo-ch4.elf capture.bin
+"""
+import struct
+import sys
+
+FRAME_SYNC = 0xA5
+FRAME_HEADER_SIZE = 4
+
+
+def read_section(elf_path, name):
+    with open(elf_path, 'rb') as f:
+        elf = f.read()
+    if elf[:4] != b'\x7fELF' or elf[4] != 1 or elf[5] != 1:
+        raise ValueError('%s: not a 32-bit little-endian ELF file' % elf_path)
+    shoff, = struct.unpack_from('<I', elf, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from('<HHH', elf, 0x2E)
+
+    def section(index):
+        return struct.unpack_from('<IIIIII', elf, shoff + index * shentsize)
+
+    strtab_offset = section(shstrndx)[4]
+    for index in range(shnum):
+        sh_name, _, _, _, offset, size = section(index)
+        end = elf.index(b'\0', strtab_offset + sh_name)
+        if elf[strtab_offset + sh_name:end].decode() == name:
+            return elf[offset:offset + size]
+    raise ValueError('%s: no %s section' % (elf_path, name))
+
+
+def format_message(fmt, args):
+    """Same conversions as xprintf: flags 0 and -, width, fixed point precision, l prefix, s c b o d u x X."""
+    out = []
+    i = 0
+    while i < len(fmt):
+        c = fmt[i]
+        i += 1
+        if c != '%':
+            out.append(c)
+            continue
+        zero = left = False
+        width = 0
+        precision = 0
+        if i < len(fmt) and fmt[i] == '0':
+            zero = True
+            i += 1
+        elif i < len(fmt) and fmt[i] == '-':
+            left = True
+            i += 1
+        while i < len(fmt) and fmt[i].isdigit():
+            width = width * 10 + int(fmt[i])
+            i += 1
+        if i < len(fmt) and fmt[i] == '.':
+            i += 1
+            while i < len(fmt) and fmt[i].isdigit():
+                precision = precision * 10 + int(fmt[i])
+                i += 1
+        if i < len(fmt) and fmt[i] in 'lL':
+            i += 1
+        if i >= len(fmt):
+            break
+        c = fmt[i]
+        i += 1
+        d = c.upper()
+        if d == 'S':
+            text = args.pop(0) if args else '?'
+        elif d == 'C':
+            text = args.pop(0) if args else '?'
+        elif d in 'BODUX':
+            value = args.pop(0) if args else 0
+            if d == 'D' and value & 0x80000000:
+                value -= 1 << 32
+            if d == 'B':
+                text = format(value, 'b')
+            elif d == 'O':
+                text = format(value, 'o')
+            elif d == 'X':
+                text = format(value, 'x' if c == 'x' else 'X')
+            else:
+                text = str(abs(value))
+                if precision:
+                    text = text.rjust(precision + 1, '0')
+                    text = text[:-precision] + '.' + text[-precision:]
+                if value < 0:
+                    text = '-' + text
+        else:
+            out.append(c)
+            continue
+        pad = max(0, width - len(text))
+        if left:
+            text = text + ' ' * pad
+        else:
+            text = ('0' if zero and d != 'S' else ' ') * pad + text
+        out.append(text)
+    return ''.join(out)
+
+
+def decode_args(fmt, payload):
+    """Split the raw arguments according to the conversions of the format."""
+    args = []
+    pos = 0
+    i = 0
+    while i < len(fmt):
+        if fmt[i] != '%':
+            i += 1
+            continue
+        i += 1
+        while i < len(fmt) and (fmt[i] in '0-.lL' or fmt[i].isdigit()):
+            i += 1
+        if i >= len(fmt):
+            break
+        d = fmt[i].lower()
+        i += 1
+        if d == 's':
+            end = payload.find(b'\0', pos)
+            if end < 0:
+                end = len(payload)
+            args.append(payload[pos:end].decode('ascii', 'replace'))
+            pos = end + 1
+        elif d == 'c':
+            if pos < len(payload):
+                args.append(chr(payload[pos]))
+            pos += 1
+        elif d in 'boudx':
+            if pos + 4 <= len(payload):
+                args.append(struct.unpack_from('<I', payload, pos)[0])
+            pos += 4
+    return args
+
+
+def decode_stream(formats, stream, output):
+    buffer = b''
+    while True:
+        chunk = stream.read(1) if stream.isatty() else stream.read(4096)
+        if not chunk:
+            break
+        buffer += chunk
+        while True:
+            start = buffer.find(bytes([FRAME_SYNC]))
+            if start < 0:
+                buffer = b''
+                break
+            buffer = buffer[start:]
+            if len(buffer) < FRAME_HEADER_SIZE:
+                break
+            message_id, length = struct.unpack_from('<HB', buffer, 1)
+            if len(buffer) < FRAME_HEADER_SIZE + length:
+                break
+            payload = buffer[FRAME_HEADER_SIZE:FRAME_HEADER_SIZE + length]
+            buffer = buffer[FRAME_HEADER_SIZE + length:]
+            if message_id >= len(formats):
+                output.write('<unknown message %d>\n' % message_id)
+                continue
+            fmt = formats[message_id:formats.index(b'\0', message_id)].decode('ascii', 'replace')
+            output.write(format_message(fmt, decode_args(fmt, payload)) + '\n')
+            output.flush()
+
+
+def main(argv):
+    if len(argv) not in (2, 3):
+        sys.stderr.write(__doc__)
+        return 1
+    formats = read_section(argv[1], '.logfmt')
+    if len(argv) == 3:
+        with open(argv[2], 'rb') as stream:
+            decode_stream(formats, stream, sys.stdout)
+    else:
+        decode_stream(formats, sys.stdin.buffer, sys.stdout)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))